@@ -0,0 +1,58 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Airbuds/Track.hpp"
+
+namespace AirbudsSearch::Benchmark {
+
+inline std::vector<std::string> split(const std::string_view text, const char delimiter) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        const size_t end = text.find(delimiter, start);
+        parts.emplace_back(text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+        if (end == std::string_view::npos) {
+            return parts;
+        }
+        start = end + 1;
+    }
+}
+
+/**
+ * Reads the tab-separated rows of a corpus file, skipping empty lines and # comments.
+ */
+inline std::vector<std::vector<std::string>> readRows(const std::filesystem::path& path) {
+    std::vector<std::vector<std::string>> rows;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        rows.push_back(split(line, '\t'));
+    }
+    return rows;
+}
+
+/**
+ * Builds a track from its corpus fields. The artists are separated by ";".
+ */
+inline airbuds::Track makeTrack(const std::string& id, const std::string& name, const std::string& artists) {
+    airbuds::Track track;
+    track.id = id;
+    track.name = name;
+    for (const std::string& artistName : split(artists, ';')) {
+        track.artists.push_back(airbuds::Artist{artistName, artistName});
+    }
+    return track;
+}
+
+}// namespace AirbudsSearch::Benchmark
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "CorpusReader.hpp"
+#include "Filter.hpp"
+#include "ScoringPipeline.hpp"
+
+// Replays the search pages in benchmark/corpus/replay.tsv through query building and scoring, the way TrackMatcher does
+// for the online search, and reports how well the expected map ranks and how long it took. The corpus is synthetic
+// (hand-made pages and expected maps), so the ranking numbers only show whether a change moved the results.
+//
+// The report is a single JSON object on stdout, so runs can be compared and gated by scripts:
+//   mrr, top1          Mean reciprocal rank of the expected map, and how often it ranked first
+//   latencyMicros      p50, p99 and mean time to rank the results of one track, from building its queries
+//   allocations        Heap allocations per track (mean and max)
+//   missingResponses   Queries that have no page in the corpus. Extend the corpus when the queries change.
+//   tracks             The same numbers for every track
+//
+// Every page of every query is replayed. The early stopping of TrackMatcher depends on the order in which the requests
+// finish, so it is left out to keep the results deterministic.
+//
+// Usage: airbuds-search-core-replay [corpus file] [rounds]
+
+using namespace AirbudsSearch;
+
+// Only counted while a track is being ranked
+static std::atomic<bool> isCountingAllocations = false;
+static std::atomic<size_t> allocationCount = 0;
+
+void* operator new(const std::size_t size) {
+    if (isCountingAllocations.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+// Matches the page size of TrackMatcher
+static constexpr size_t PAGE_SIZE = 20;
+
+// Default number of rounds over the corpus. The first one only warms up the caches and isn't measured.
+static constexpr size_t DEFAULT_ROUNDS = 5;
+
+struct RecordedDoc {
+    std::string hash;
+    std::string songName;
+    std::string mapName;
+    std::string songAuthor;
+    std::string levelAuthor;
+    float rating = 0.0f;
+};
+
+struct ReplayTrack {
+    airbuds::Track track;
+    std::string expectedHash;
+};
+
+struct ReplayCorpus {
+    std::vector<ReplayTrack> tracks;
+
+    // Pages of each query, in page order
+    std::unordered_map<std::string, std::vector<std::vector<RecordedDoc>>> responses;
+};
+
+struct RankedResult {
+    std::string hash;
+    int score = 0;
+    int rank = 0;
+};
+
+struct TrackReport {
+    // 1-based rank of the expected map, if it was found at all
+    std::optional<size_t> expectedRank;
+    std::string topHash;
+    size_t missingResponses = 0;
+    std::vector<double> latencyMicros;
+    size_t allocations = 0;
+};
+
+static ReplayCorpus loadCorpus(const std::filesystem::path& path) {
+    ReplayCorpus corpus;
+    for (const std::vector<std::string>& row : Benchmark::readRows(path)) {
+        if (row[0] == "track" && row.size() >= 5) {
+            corpus.tracks.push_back(ReplayTrack{Benchmark::makeTrack(row[1], row[2], row[3]), row[4]});
+        } else if (row[0] == "response" && row.size() >= 3) {
+            const size_t page = std::strtoul(row[2].c_str(), nullptr, 10);
+            std::vector<std::vector<RecordedDoc>>& pages = corpus.responses[row[1]];
+            if (pages.size() <= page) {
+                pages.resize(page + 1);
+            }
+
+            // A row without a doc records an empty page
+            if (row.size() >= 9) {
+                pages[page].push_back(RecordedDoc{row[3], row[4], row[5], row[6], row[7], std::strtof(row[8].c_str(), nullptr)});
+            }
+        }
+    }
+    return corpus;
+}
+
+// Same steps as the online search of TrackMatcher::findMatches(), minus the SongDetails lookups: every corpus doc is
+// treated as a map that exists in the cache
+static std::vector<RankedResult> rankTrack(const ReplayCorpus& corpus, const airbuds::Track& track, size_t& missingResponses) {
+    const Filter::TrackMatchInfo trackInfo = Filter::buildTrackMatchInfo(track);
+    const std::vector<Filter::QuerySpec> queries = Filter::buildBeatSaverQueries(track, trackInfo.artists);
+
+    std::unordered_map<std::string, RankedResult> results;
+    for (size_t queryIndex = 0; queryIndex < queries.size(); ++queryIndex) {
+        const Filter::QuerySpec& spec = queries[queryIndex];
+        const auto it = corpus.responses.find(spec.query);
+        if (it == corpus.responses.end()) {
+            ++missingResponses;
+            continue;
+        }
+        for (size_t page = 0; page < it->second.size(); ++page) {
+            const std::vector<RecordedDoc>& docs = it->second[page];
+            Scoring::CandidateBatch batch(trackInfo);
+            batch.reserve(docs.size());
+            for (const RecordedDoc& doc : docs) {
+                batch.add(doc.songName, doc.mapName, doc.songAuthor, doc.levelAuthor, doc.rating, false);
+            }
+
+            const std::vector<int> matchScores = Scoring::scoreBatch(trackInfo, batch, false);
+            for (size_t i = 0; i < docs.size(); ++i) {
+                const size_t docIndex = page * PAGE_SIZE + i;
+                const RankedResult result{
+                    docs[i].hash,
+                    Scoring::getResultScore(spec.baseScore, matchScores[i], docIndex),
+                    Scoring::getResultRank(queryIndex, docIndex),
+                };
+                const auto [existing, inserted] = results.emplace(docs[i].hash, result);
+                if (!inserted && (result.score > existing->second.score || (result.score == existing->second.score && result.rank < existing->second.rank))) {
+                    existing->second = result;
+                }
+            }
+        }
+    }
+
+    std::vector<RankedResult> rankedResults;
+    rankedResults.reserve(results.size());
+    for (auto& [hash, result] : results) {
+        rankedResults.push_back(std::move(result));
+    }
+    std::sort(rankedResults.begin(), rankedResults.end(), [](const RankedResult& a, const RankedResult& b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        return a.rank < b.rank;
+    });
+    return rankedResults;
+}
+
+static double getPercentile(std::vector<double> values, const double percentile) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t index = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(values.size())));
+    return values[std::clamp<size_t>(index, 1, values.size()) - 1];
+}
+
+static std::string toJsonString(const std::string_view text) {
+    std::string json = "\"";
+    for (const char c : text) {
+        switch (c) {
+            case '"':
+                json += "\\\"";
+                break;
+            case '\\':
+                json += "\\\\";
+                break;
+            case '\n':
+                json += "\\n";
+                break;
+            case '\t':
+                json += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    json += escaped;
+                } else {
+                    json += c;
+                }
+        }
+    }
+    json += '"';
+    return json;
+}
+
+int main(int argc, char** argv) {
+    const std::filesystem::path corpusPath = argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::path(BENCHMARK_CORPUS_DIR) / "replay.tsv";
+    const size_t rounds = std::max<size_t>(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : DEFAULT_ROUNDS, 2);
+
+    const ReplayCorpus corpus = loadCorpus(corpusPath);
+    if (corpus.tracks.empty()) {
+        std::fprintf(stderr, "No replay corpus found in %s\n", corpusPath.string().c_str());
+        return 1;
+    }
+
+    std::vector<TrackReport> reports(corpus.tracks.size());
+    for (size_t round = 0; round < rounds; ++round) {
+        const bool isWarmUp = round == 0;
+        for (size_t i = 0; i < corpus.tracks.size(); ++i) {
+            TrackReport& report = reports[i];
+            size_t missingResponses = 0;
+
+            allocationCount = 0;
+            isCountingAllocations = true;
+            const auto startTime = std::chrono::steady_clock::now();
+            const std::vector<RankedResult> rankedResults = rankTrack(corpus, corpus.tracks[i].track, missingResponses);
+            const auto elapsed = std::chrono::steady_clock::now() - startTime;
+            isCountingAllocations = false;
+
+            if (isWarmUp) {
+                continue;
+            }
+            report.latencyMicros.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+            report.allocations = std::max(report.allocations, allocationCount.load());
+
+            // The ranking is deterministic, so the last round is as good as any
+            report.missingResponses = missingResponses;
+            report.topHash = rankedResults.empty() ? std::string() : rankedResults.front().hash;
+            report.expectedRank.reset();
+            for (size_t rank = 0; rank < rankedResults.size(); ++rank) {
+                if (rankedResults[rank].hash == corpus.tracks[i].expectedHash) {
+                    report.expectedRank = rank + 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    double reciprocalRankSum = 0.0;
+    size_t top1Count = 0;
+    size_t missingResponses = 0;
+    size_t allocationSum = 0;
+    size_t maxAllocations = 0;
+    std::vector<double> latencyMicros;
+    for (const TrackReport& report : reports) {
+        if (report.expectedRank) {
+            reciprocalRankSum += 1.0 / static_cast<double>(*report.expectedRank);
+            top1Count += *report.expectedRank == 1 ? 1 : 0;
+        }
+        missingResponses += report.missingResponses;
+        allocationSum += report.allocations;
+        maxAllocations = std::max(maxAllocations, report.allocations);
+        latencyMicros.insert(latencyMicros.end(), report.latencyMicros.begin(), report.latencyMicros.end());
+    }
+    const double trackCount = static_cast<double>(reports.size());
+    double latencySum = 0.0;
+    for (const double latency : latencyMicros) {
+        latencySum += latency;
+    }
+
+    std::printf("{\n");
+    std::printf("  \"trackCount\": %zu,\n", reports.size());
+    std::printf("  \"rounds\": %zu,\n", rounds - 1);
+    std::printf("  \"mrr\": %.4f,\n", reciprocalRankSum / trackCount);
+    std::printf("  \"top1\": %.4f,\n", static_cast<double>(top1Count) / trackCount);
+    std::printf(
+        "  \"latencyMicros\": {\"p50\": %.1f, \"p99\": %.1f, \"mean\": %.1f},\n",
+        getPercentile(latencyMicros, 50.0),
+        getPercentile(latencyMicros, 99.0),
+        latencySum / static_cast<double>(latencyMicros.size()));
+    std::printf("  \"allocations\": {\"mean\": %.1f, \"max\": %zu},\n", static_cast<double>(allocationSum) / trackCount, maxAllocations);
+    std::printf("  \"missingResponses\": %zu,\n", missingResponses);
+    std::printf("  \"tracks\": [\n");
+    for (size_t i = 0; i < reports.size(); ++i) {
+        const TrackReport& report = reports[i];
+        const std::string expectedRank = report.expectedRank ? std::to_string(*report.expectedRank) : "null";
+        std::printf(
+            "    {\"id\": %s, \"name\": %s, \"expectedRank\": %s, \"topHash\": %s, \"p50Micros\": %.1f, \"allocations\": %zu, \"missingResponses\": %zu}%s\n",
+            toJsonString(corpus.tracks[i].track.id).c_str(),
+            toJsonString(corpus.tracks[i].track.name).c_str(),
+            expectedRank.c_str(),
+            toJsonString(report.topHash).c_str(),
+            getPercentile(report.latencyMicros, 50.0),
+            report.allocations,
+            report.missingResponses,
+            i + 1 < reports.size() ? "," : "");
+    }
+    std::printf("  ]\n");
+    std::printf("}\n");
+    return 0;
+}
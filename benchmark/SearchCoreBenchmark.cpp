@@ -0,0 +1,198 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CorpusReader.hpp"
+#include "Filter.hpp"
+#include "ScoringPipeline.hpp"
+
+// Measures the search core over the hand-made corpus, in the style of Google Benchmark: every benchmark runs with a
+// doubling iteration count until one run takes long enough to be timed reliably, then reports the time per item.
+//
+// Usage: airbuds-search-core-benchmark [corpus directory] [benchmark name filter]
+
+using namespace AirbudsSearch;
+
+struct CandidateRecord {
+    std::string songName;
+    std::string mapName;
+    std::string songAuthor;
+    std::string levelAuthor;
+    float rating = 0.0f;
+};
+
+struct Corpus {
+    std::vector<airbuds::Track> tracks;
+    std::vector<CandidateRecord> candidates;
+};
+
+// A run of a benchmark must take at least this long to be reported
+static constexpr std::chrono::milliseconds MIN_RUN_TIME{500};
+
+static constexpr size_t MAX_ITERATIONS = size_t{1} << 24;
+
+// Results are added here so the compiler can't drop the work being measured
+static volatile size_t sink = 0;
+
+static Corpus loadCorpus(const std::filesystem::path& directory) {
+    Corpus corpus;
+    for (const std::vector<std::string>& row : Benchmark::readRows(directory / "tracks.tsv")) {
+        if (row.size() < 2) {
+            continue;
+        }
+        corpus.tracks.push_back(Benchmark::makeTrack(row[0], row[0], row[1]));
+    }
+    for (const std::vector<std::string>& row : Benchmark::readRows(directory / "candidates.tsv")) {
+        if (row.size() < 5) {
+            continue;
+        }
+        corpus.candidates.push_back(CandidateRecord{row[0], row[1], row[2], row[3], std::strtof(row[4].c_str(), nullptr)});
+    }
+    return corpus;
+}
+
+template<typename Function>
+static void runBenchmark(const std::string_view filter, const std::string& name, const size_t itemsPerIteration, Function&& function) {
+    if (!filter.empty() && name.find(filter) == std::string::npos) {
+        return;
+    }
+
+    // The first call warms up the caches, including the romanization cache
+    sink = sink + function();
+
+    size_t iterations = 1;
+    while (true) {
+        const auto startTime = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            sink = sink + function();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - startTime;
+        if (elapsed >= MIN_RUN_TIME || iterations >= MAX_ITERATIONS) {
+            const double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+            const double items = static_cast<double>(iterations * itemsPerIteration);
+            std::printf("%-40s %12.1f ns/item %12zu iterations %10zu items/iteration\n", name.c_str(), nanoseconds / items, iterations, itemsPerIteration);
+            return;
+        }
+        iterations *= 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::filesystem::path corpusDirectory = argc > 1 ? argv[1] : BENCHMARK_CORPUS_DIR;
+    const std::string_view filter = argc > 2 ? argv[2] : "";
+
+    const Corpus corpus = loadCorpus(corpusDirectory);
+    if (corpus.tracks.empty() || corpus.candidates.empty()) {
+        std::fprintf(stderr, "No corpus found in %s\n", corpusDirectory.string().c_str());
+        return 1;
+    }
+    std::printf("Corpus: %zu tracks, %zu candidates\n\n", corpus.tracks.size(), corpus.candidates.size());
+
+    std::vector<std::string> texts;
+    for (const airbuds::Track& track : corpus.tracks) {
+        texts.push_back(track.name);
+    }
+    for (const CandidateRecord& candidate : corpus.candidates) {
+        texts.push_back(candidate.songName);
+        texts.push_back(candidate.songAuthor);
+    }
+
+    runBenchmark(filter, "BM_Tokenize", texts.size(), [&texts]() {
+        size_t result = 0;
+        for (const std::string& text : texts) {
+            result += Filter::tokenize(text).getTokens().size();
+        }
+        return result;
+    });
+
+    runBenchmark(filter, "BM_GetWords", texts.size(), [&texts]() {
+        size_t result = 0;
+        for (const std::string& text : texts) {
+            result += Filter::getWords(text).size();
+        }
+        return result;
+    });
+
+    runBenchmark(filter, "BM_SplitWords", texts.size(), [&texts]() {
+        // The list is reused like in the local song index
+        static WordList words;
+        size_t result = 0;
+        for (const std::string& text : texts) {
+            words.clear();
+            Filter::splitWords(text, words);
+            result += words.size();
+        }
+        return result;
+    });
+
+    runBenchmark(filter, "BM_RomanizeJapanese/cached", texts.size(), [&texts]() {
+        size_t result = 0;
+        for (const std::string& text : texts) {
+            result += Filter::romanizeJapanese(text).size();
+        }
+        return result;
+    });
+
+    runBenchmark(filter, "BM_BuildTrackMatchInfo", corpus.tracks.size(), [&corpus]() {
+        size_t result = 0;
+        for (const airbuds::Track& track : corpus.tracks) {
+            result += Filter::buildTrackMatchInfo(track).artists.size();
+        }
+        return result;
+    });
+
+    std::vector<Filter::TrackMatchInfo> trackInfos;
+    for (const airbuds::Track& track : corpus.tracks) {
+        trackInfos.push_back(Filter::buildTrackMatchInfo(track));
+    }
+
+    runBenchmark(filter, "BM_BuildBeatSaverQueries", corpus.tracks.size(), [&corpus, &trackInfos]() {
+        size_t result = 0;
+        for (size_t i = 0; i < corpus.tracks.size(); ++i) {
+            result += Filter::buildBeatSaverQueries(corpus.tracks[i], trackInfos[i].artists).size();
+        }
+        return result;
+    });
+
+    // Batch preparation (tokenizing and normalizing every candidate field) and the scoring stages are measured
+    // separately, since the first depends on the candidates and the second on the track
+    runBenchmark(filter, "BM_PrepareCandidateBatch", corpus.tracks.size() * corpus.candidates.size(), [&corpus, &trackInfos]() {
+        size_t result = 0;
+        for (const Filter::TrackMatchInfo& trackInfo : trackInfos) {
+            Scoring::CandidateBatch batch(trackInfo);
+            batch.reserve(corpus.candidates.size());
+            for (const CandidateRecord& candidate : corpus.candidates) {
+                batch.add(candidate.songName, candidate.mapName, candidate.songAuthor, candidate.levelAuthor, candidate.rating, false);
+            }
+            result += batch.size();
+        }
+        return result;
+    });
+
+    std::vector<Scoring::CandidateBatch> batches;
+    for (const Filter::TrackMatchInfo& trackInfo : trackInfos) {
+        Scoring::CandidateBatch& batch = batches.emplace_back(trackInfo);
+        for (const CandidateRecord& candidate : corpus.candidates) {
+            batch.add(candidate.songName, candidate.mapName, candidate.songAuthor, candidate.levelAuthor, candidate.rating, false);
+        }
+    }
+
+    for (const bool artistBoost : {false, true}) {
+        const std::string name = artistBoost ? "BM_ScoreBatch/artistBoost" : "BM_ScoreBatch";
+        runBenchmark(filter, name, corpus.tracks.size() * corpus.candidates.size(), [&trackInfos, &batches, artistBoost]() {
+            size_t result = 0;
+            for (size_t i = 0; i < trackInfos.size(); ++i) {
+                for (const int score : Scoring::scoreBatch(trackInfos[i], batches[i], artistBoost)) {
+                    result += static_cast<size_t>(score);
+                }
+            }
+            return result;
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,30 @@
+include_guard()
+
+# Desktop (Linux x86-64) build of the search core: the matching logic that doesn't depend on the game or Unity, so it
+# can be profiled and benchmarked without a headset. The mod compiles the same sources as part of its own library.
+
+set(CORE_SOURCES
+        ${SOURCE_DIR}/AhoCorasick.cpp
+        ${SOURCE_DIR}/FileUtils.cpp
+        ${SOURCE_DIR}/Filter.cpp
+        ${SOURCE_DIR}/FuzzyMatch.cpp
+        ${SOURCE_DIR}/Normalization.cpp
+        ${SOURCE_DIR}/RomanizationCache.cpp
+        ${SOURCE_DIR}/ScoringPipeline.cpp
+)
+
+find_package(Threads REQUIRED)
+
+add_library(airbuds-search-core STATIC ${CORE_SOURCES})
+target_include_directories(airbuds-search-core PUBLIC ${INCLUDE_DIR})
+target_link_libraries(airbuds-search-core PUBLIC Threads::Threads ${CMAKE_DL_LIBS})
+
+# Benchmark over the recorded corpus in benchmark/corpus
+add_executable(airbuds-search-core-benchmark ${CMAKE_CURRENT_SOURCE_DIR}/benchmark/SearchCoreBenchmark.cpp)
+target_link_libraries(airbuds-search-core-benchmark PRIVATE airbuds-search-core)
+target_compile_definitions(airbuds-search-core-benchmark PRIVATE BENCHMARK_CORPUS_DIR="${CMAKE_CURRENT_SOURCE_DIR}/benchmark/corpus")
+
+# Ranking and latency regression runner over the synthetic search pages in benchmark/corpus/replay.tsv
+add_executable(airbuds-search-core-replay ${CMAKE_CURRENT_SOURCE_DIR}/benchmark/RelevanceReplay.cpp)
+target_link_libraries(airbuds-search-core-replay PRIVATE airbuds-search-core)
+target_compile_definitions(airbuds-search-core-replay PRIVATE BENCHMARK_CORPUS_DIR="${CMAKE_CURRENT_SOURCE_DIR}/benchmark/corpus")
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace AirbudsSearch {
+
+/**
+ * Replaces many patterns in a text in one pass, using an Aho-Corasick automaton over the bytes of the patterns.
+ * Matches are leftmost-longest and don't overlap: of the matches that start first, the longest one is replaced, and
+ * the search continues after it. Replacements are never searched again.
+ *
+ * The automaton is immutable once built, so it can be shared between threads.
+ */
+class AhoCorasick {
+
+    public:
+    AhoCorasick() = default;
+
+    /**
+     * @param replacements Pairs of pattern and replacement. Empty patterns are ignored. If a pattern appears more than
+     * once, the last replacement wins.
+     */
+    explicit AhoCorasick(const std::vector<std::pair<std::string, std::string>>& replacements);
+
+    size_t getPatternCount() const {
+        return replacements_.size();
+    }
+
+    /**
+     * @return The text with every match replaced.
+     */
+    std::string replaceAll(std::string_view text) const;
+
+    private:
+    struct Edge {
+        uint8_t byte;
+        uint32_t target;
+    };
+
+    struct State {
+        // Outgoing edges, sorted by byte, in edges_
+        uint32_t edgesBegin = 0;
+        uint32_t edgesEnd = 0;
+
+        // Longest proper suffix of this state that is also a state
+        uint32_t failure = 0;
+
+        // Length of the prefix this state stands for
+        uint32_t depth = 0;
+
+        // Pattern that ends here, or the longest pattern that ends at a suffix of this state. NO_PATTERN if neither.
+        uint32_t pattern = NO_PATTERN;
+    };
+
+    static constexpr uint32_t ROOT = 0;
+    static constexpr uint32_t NO_PATTERN = UINT32_MAX;
+
+    std::vector<State> states_;
+    std::vector<Edge> edges_;
+
+    // The root is where most bytes go, so its transitions are looked up directly
+    std::array<uint32_t, 256> rootTransitions_{};
+
+    std::vector<std::string> replacements_;
+    std::vector<uint32_t> patternLengths_;
+
+    uint32_t findEdge(uint32_t state, uint8_t byte) const;
+
+    uint32_t next(uint32_t state, uint8_t byte) const;
+};
+
+}// namespace AirbudsSearch
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <filesystem>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -11,6 +13,7 @@
 
 #include "Configuration.hpp"
 #include "Log.hpp"
+#include "RateLimiter.hpp"
 #include "Airbuds/Friend.hpp"
 #include "Airbuds/Playlist.hpp"
 #include "Airbuds/Track.hpp"
@@ -28,6 +31,19 @@ class Client {
     std::vector<Friend> getFriends();
     std::vector<PlaylistTrack> getRecentlyPlayedForUser(const std::string& userId);
     std::vector<PlaylistTrack> getRecentlyPlayedCachedOnlyForUser(const std::string& userId);
+
+    /**
+     * Refreshes the history of every friend in the background, if enabled in the config. Friends are refreshed in
+     * parallel, bounded by the configured number of connections and requests per minute, and the results are stored in
+     * the same caches as getRecentlyPlayedForUser(). Does nothing while a previous refresh is still running.
+     */
+    void refreshFriendHistoriesAsync(const std::vector<Friend>& friends);
+
+    /**
+     * @return Whether the history of the user was refreshed recently enough to be shown from the cache without
+     * refreshing it again.
+     */
+    bool isRecentlyPlayedFreshForUser(const std::string& userId);
     std::vector<PlaylistTrack> getPlaylistTracksForUser(std::string_view userId, std::string_view playlistId);
 
     std::vector<PlaylistTrack> getPlaylistTracks(std::string_view playlistId);
@@ -44,18 +60,28 @@ class Client {
     private:
     static constexpr size_t AIRBUDS_PAGE_LIMIT = 30;
 
+    // How long a refreshed friend history is shown from the cache without refreshing it again
+    static constexpr std::chrono::minutes FRIEND_HISTORY_FRESH_DURATION{10};
+
     struct AirbudsCredentials {
         std::string accessToken;
         std::string userId;
     };
 
+    // Guards the access token. Held while refreshing it, so concurrent requests refresh it only once.
+    std::mutex credentialsMutex_;
     std::string airbudsAccessToken_;
     std::string airbudsUserId_;
     std::optional<std::chrono::system_clock::time_point> airbudsAccessTokenExpiry_;
 
+    // Guards the cached histories and the warning, which are shared with the background refresh
+    mutable std::mutex cacheMutex_;
     std::string lastRecentlyPlayedWarning_;
     std::vector<PlaylistTrack> cachedRecentlyPlayedTracks_;
     std::unordered_map<std::string, std::vector<PlaylistTrack>> cachedFriendRecentlyPlayedTracks_;
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> friendRecentlyPlayedRefreshTimes_;
+
+    std::atomic<bool> isRefreshingFriendHistories_ = false;
 
     std::optional<AirbudsCredentials> getAirbudsCredentials();
     bool isAirbudsAccessTokenValid() const;
@@ -69,10 +95,19 @@ class Client {
     rapidjson::Document apiGetFriends(const AirbudsCredentials& credentials);
 
     std::vector<PlaylistTrack> getRecentlyPlayedTracks();
+    /**
+     * Fetches the history pages that are newer than the cache file, and merges them into it.
+     * @param warning Set if the refresh failed and the cached history is returned instead.
+     * @param backgroundRateLimiter Set for background refreshes. Paces the page requests, and leaves matching and
+     * romanizing the new tracks to the caller.
+     */
     std::vector<PlaylistTrack> getRecentlyPlayedTracksForUser(
         const std::string& userId,
-        std::vector<PlaylistTrack>* cachedTracks,
-        const std::filesystem::path& cachePath);
+        const std::filesystem::path& cachePath,
+        std::string& warning,
+        AirbudsSearch::RateLimiter* backgroundRateLimiter = nullptr);
+
+    void setCachedRecentlyPlayedTracks(const std::string& userId, const std::vector<PlaylistTrack>& tracks, bool isRefreshed);
 };
 
 } // namespace airbuds
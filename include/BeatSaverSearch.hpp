@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CancellationToken.hpp"
+#include "SearchCandidate.hpp"
+
+namespace AirbudsSearch::BeatSaverSearch {
+
+struct SearchPageResult {
+    bool successful = false;
+    bool cancelled = false;
+    bool fromCache = false;
+    int httpCode = 0;
+    std::vector<SearchCandidate> docs;
+};
+
+std::string urlEncodeQuery(std::string_view text);
+
+/**
+ * Fetches one page of BeatSaver text search results, sorted by relevance. Blocks until the response is parsed or
+ * the cancellation token is cancelled. Responses are cached on disk, see SearchResponseCache.
+ */
+SearchPageResult fetchSearchPage(const std::string& query, int page, const CancellationToken& cancellationToken);
+
+}// namespace AirbudsSearch::BeatSaverSearch
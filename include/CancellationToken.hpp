@@ -0,0 +1,28 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace AirbudsSearch {
+
+/**
+ * A cheap, copyable cancellation flag. Copies share the same state, so a token can be handed to worker threads and
+ * cancelled later from the thread that created it.
+ */
+class CancellationToken {
+    public:
+    CancellationToken() : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() const {
+        cancelled_->store(true);
+    }
+
+    bool isCancelled() const {
+        return cancelled_->load();
+    }
+
+    private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+}// namespace AirbudsSearch
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <string_view>
 
@@ -22,4 +23,34 @@ std::string getAirbudsRefreshToken();
 void setAirbudsRefreshToken(std::string_view token);
 void clearAirbudsRefreshToken();
 
+// Whether the histories of all friends are refreshed in the background when the friend list is loaded
+bool isFriendHistorySyncEnabled();
+
+// Maximum number of friend histories that are refreshed at once in the background
+size_t getFriendHistorySyncMaxConnections();
+
+// Maximum number of history pages requested per minute by the background refresh
+size_t getFriendHistorySyncRequestsPerMinute();
+
+// Maximum number of BeatSaver search requests that may be in flight at once for a single track search
+size_t getSearchMaxConcurrentRequests();
+
+// Whether search results are shown as each query completes instead of once every query has finished
+bool isProgressiveSearchEnabled();
+
+// Whether the BeatSaver search API is used in addition to the local song index
+bool isOnlineSearchEnabled();
+
+// How long cached BeatSaver search responses are used before they are refreshed in the background
+std::chrono::hours getSearchCacheTtl();
+
+// Size limit of the BeatSaver search response cache. 0 disables the cache.
+uintmax_t getSearchCacheMaxSizeBytes();
+
+// Number of tracks above and below the selected one whose searches are prefetched. 0 disables prefetching.
+size_t getSearchPrefetchCount();
+
+// How long the stored matches of a history track are shown without searching again
+std::chrono::hours getMatchIndexTtl();
+
 }
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <filesystem>
+#include <initializer_list>
+#include <string_view>
+
+namespace AirbudsSearch::Utils {
+
+/**
+ * Writes the parts one after the other to a temporary file next to the path, then renames it over the path, so a
+ * crash or a failed write (a full disk, for example) can't leave a truncated file behind. The temporary file is
+ * removed if anything fails.
+ * @return Whether the file was written. Failures are logged.
+ */
+bool writeFileAtomically(const std::filesystem::path& path, std::initializer_list<std::string_view> parts);
+
+inline bool writeFileAtomically(const std::filesystem::path& path, const std::string_view contents) {
+    return writeFileAtomically(path, {contents});
+}
+
+}// namespace AirbudsSearch::Utils
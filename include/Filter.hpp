@@ -0,0 +1,100 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Airbuds/Track.hpp"
+#include "FuzzyMatch.hpp"
+#include "TokenizedText.hpp"
+#include "WordList.hpp"
+
+namespace AirbudsSearch::Filter {
+
+// Added to the score of candidates that have one of the preferred difficulties
+constexpr int DIFFICULTY_BONUS = 25;
+
+struct QuerySpec {
+    std::string query;
+    std::string label;
+    int baseScore = 0;
+};
+
+struct ArtistMatchInfo {
+    std::string name;
+    std::string romaji;
+    TokenizedText nameTokens;
+    TokenizedText romajiTokens;
+};
+
+/**
+ * Everything about a track that candidate scoring needs, computed once per search.
+ */
+struct TrackMatchInfo {
+    std::string romaji;
+    TokenizedText nameTokens;
+    TokenizedText romajiTokens;
+    FuzzyMatch::Pattern namePattern;
+    FuzzyMatch::Pattern romajiPattern;
+    std::vector<ArtistMatchInfo> artists;
+};
+
+void captureMainThreadId();
+
+/**
+ * Splits the text into lowercase words, as they are sent in search queries. Runs of Japanese characters are kept
+ * together as a single word.
+ */
+std::vector<std::string> getWords(const std::string& text);
+
+/**
+ * The words to match on: same as getWords(), after Normalization::foldForMatching(), followed by every pair of adjacent
+ * characters in Japanese runs. Titles without word separators then still share words when only part of a run is the
+ * same. Appends them to the list without allocating a string per word.
+ */
+void splitWords(std::string_view text, WordList& words);
+
+/**
+ * Converts the Japanese parts of the text to lowercase romaji. Returns an empty string if the text doesn't contain
+ * any Japanese and no romaji override applies to it. Results are kept in the RomanizationCache.
+ */
+std::string romanizeJapanese(const std::string& text);
+
+/**
+ * Same words and bigrams as splitWords(), but hashed into a TokenizedText. Bigrams are only kept while there is room
+ * left after the words. Doesn't allocate unless the text is very long.
+ */
+TokenizedText tokenize(std::string_view text);
+
+std::string getTrackRomajiCached(const airbuds::Track& track);
+
+/**
+ * Romanizes the names and artists of the tracks on a background thread, then saves the RomanizationCache, so later
+ * searches for them don't need the Japanese converter.
+ */
+void warmRomanizationCache(const std::vector<airbuds::PlaylistTrack>& tracks);
+
+std::vector<ArtistMatchInfo> buildArtistInfos(const std::vector<airbuds::Artist>& artists);
+
+TrackMatchInfo buildTrackMatchInfo(const airbuds::Track& track);
+
+std::string getArtistRomajiLog(const std::vector<ArtistMatchInfo>& infos);
+
+/**
+ * Builds the list of search queries for a track, sorted by base score (best first).
+ */
+std::vector<QuerySpec> buildBeatSaverQueries(const airbuds::Track& track, const std::vector<ArtistMatchInfo>& artistInfos);
+
+int scoreTextMatch(const std::string& needle, const std::string& haystack);
+
+/**
+ * Same as scoreTextMatch(), for text that has already been tokenized. Doesn't allocate.
+ */
+int scoreTextMatch(const TokenizedText& needle, const TokenizedText& haystack);
+
+/**
+ * @return The highest score scoreTextMatch() can return for the needle, whatever the haystack.
+ */
+int getMaxTextMatchScore(const TokenizedText& needle);
+
+}// namespace AirbudsSearch::Filter
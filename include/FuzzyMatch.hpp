@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace AirbudsSearch::FuzzyMatch {
+
+// Longer text is truncated. Every symbol of the pattern must fit in one bit of a 64-bit word.
+static constexpr size_t MAX_LENGTH = 64;
+
+/**
+ * Text reduced to the symbols that matter for fuzzy matching: the text is folded with Normalization::foldForMatching(),
+ * ASCII punctuation, whitespace and CJK punctuation are dropped, and other characters are kept as code points.
+ */
+struct NormalizedText {
+    std::array<uint32_t, MAX_LENGTH> symbols{};
+    size_t length = 0;
+
+    // Every symbol is ASCII, so the table-driven edit distance can be used
+    bool isAscii = true;
+
+    // Sorted and unique
+    std::array<uint64_t, MAX_LENGTH> trigrams{};
+    size_t trigramCount = 0;
+};
+
+NormalizedText normalize(std::string_view text);
+
+/**
+ * A normalized text with its match vectors precomputed, so it can be compared against many candidates cheaply. Build
+ * it once per track.
+ */
+class Pattern {
+
+    public:
+    Pattern() = default;
+
+    explicit Pattern(std::string_view text);
+
+    const NormalizedText& getText() const {
+        return text_;
+    }
+
+    /**
+     * Levenshtein distance to the text, using the bit-parallel algorithm of Myers (as formulated by Hyyrö).
+     */
+    size_t getEditDistance(const NormalizedText& text) const;
+
+    private:
+    NormalizedText text_;
+
+    // Bit i is set if symbol i of the pattern is the given ASCII character
+    std::array<uint64_t, 128> asciiMatchVectors_{};
+
+    // Same, for patterns that contain other characters. Only the distinct symbols of the pattern are stored.
+    std::array<uint32_t, MAX_LENGTH> distinctSymbols_{};
+    std::array<uint64_t, MAX_LENGTH> distinctSymbolMatchVectors_{};
+    size_t distinctSymbolCount_ = 0;
+
+    uint64_t getMatchVector(uint32_t symbol) const;
+};
+
+/**
+ * Jaccard similarity of the symbol trigrams, between 0 and 1.
+ */
+float getTrigramSimilarity(const NormalizedText& a, const NormalizedText& b);
+
+/**
+ * The better of the edit distance and trigram similarity, as a score between 0 (unrelated) and 100 (identical after
+ * normalization).
+ */
+int getSimilarity(const Pattern& pattern, const NormalizedText& text);
+
+}// namespace AirbudsSearch::FuzzyMatch
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CancellationToken.hpp"
+
+namespace AirbudsSearch::Http {
+
+using Headers = std::vector<std::pair<std::string, std::string>>;
+
+struct Response {
+    int httpCode = 0;
+    bool cancelled = false;
+    std::string error;
+    std::string body;
+
+    // Response headers, one "Name: value" line each
+    std::string headers;
+
+    bool isSuccessful() const {
+        return !cancelled && error.empty() && httpCode >= 200 && httpCode < 300;
+    }
+};
+
+/**
+ * Performs a blocking GET request. Unlike WebUtils, the transfer is aborted as soon as the cancellation token is
+ * cancelled, even if the response is already being received. Concurrent requests for the same URL share one transfer.
+ * Connections are kept alive and reused by later requests to the same host.
+ * @param url Absolute URL including the query string. The URL must already be escaped.
+ */
+Response get(const std::string& url, const CancellationToken& cancellationToken, std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+/**
+ * Performs a blocking POST request, the same way as get(). Concurrent requests with the same URL, headers and body
+ * share one transfer.
+ * @param headers Request headers. A User-Agent header replaces the default one. The content type is passed separately.
+ */
+Response post(
+    const std::string& url,
+    const Headers& headers,
+    const std::string& body,
+    const std::string& contentType,
+    const CancellationToken& cancellationToken,
+    std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+}// namespace AirbudsSearch::Http
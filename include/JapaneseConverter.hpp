@@ -11,8 +11,41 @@ struct IJapaneseConverter {
     bool (*convert)(const char* utf8, char* outBuffer, size_t outBufferSize) = nullptr;
 };
 
+/**
+ * Version 2 of the converter interface. Starts with the same fields as version 1 (with apiVersion = 2), and adds a
+ * size query and batch conversion.
+ */
+struct IJapaneseConverterV2 {
+    uint32_t apiVersion = 0;
+    const char* name = nullptr;
+    bool (*convert)(const char* utf8, char* outBuffer, size_t outBufferSize) = nullptr;
+
+    /**
+     * @return The buffer size convert() needs for the text, including the terminating NUL, or 0 if the text can't be
+     * converted.
+     */
+    size_t (*getConvertedSize)(const char* utf8) = nullptr;
+
+    /**
+     * Converts many texts in one call. The results are written NUL-terminated and back to back into the arena, and
+     * outOffsets[i] is set to the offset of the result of texts[i] in the arena, or SIZE_MAX if it couldn't be
+     * converted.
+     * @return False without converting anything if the arena is too small. *outRequiredSize is then set to the arena
+     * size that is needed.
+     */
+    bool (*convertBatch)(
+        const char* const* texts,
+        size_t count,
+        char* arena,
+        size_t arenaSize,
+        size_t* outOffsets,
+        size_t* outRequiredSize) = nullptr;
+};
+
 using GetJapaneseConverterFn = const IJapaneseConverter* (*)();
+using GetJapaneseConverterV2Fn = const IJapaneseConverterV2* (*)();
 
 constexpr const char* kJapaneseConverterSymbol = "airbuds_search_get_japanese_converter_v1";
+constexpr const char* kJapaneseConverterV2Symbol = "airbuds_search_get_japanese_converter_v2";
 
 } // namespace AirbudsSearch
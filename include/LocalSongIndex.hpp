@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "song-details/shared/SongDetails.hpp"
+
+namespace AirbudsSearch {
+
+/**
+ * An in-memory inverted index over the song name, song author and level author of every song in the SongDetails
+ * cache. This lets us find candidate maps for a track without going through the BeatSaver search API.
+ */
+class LocalSongIndex {
+
+    public:
+    static LocalSongIndex& getInstance() {
+        static LocalSongIndex localSongIndex;
+        return localSongIndex;
+    }
+
+    /**
+     * Builds the index on a background thread. Does nothing if the index is already built or being built. The index
+     * is rebuilt whenever SongDetails refreshes its data, since it points into the SongDetails songs.
+     */
+    void buildAsync();
+
+    bool isReady() const {
+        return isReady_;
+    }
+
+    /**
+     * Finds the songs that contain the most words from the query.
+     * @return Up to `limit` songs, best match first. Empty if the index isn't ready yet.
+     */
+    std::vector<const SongDetailsCache::Song*> search(const std::string& query, size_t limit) const;
+
+    private:
+    // Posting lists hold indices into songs_. Each song appears at most once per word.
+    using PostingList = std::vector<uint32_t>;
+
+    std::vector<const SongDetailsCache::Song*> songs_;
+    std::unordered_map<std::string, PostingList> postings_;
+
+    mutable std::shared_mutex mutex_;
+    std::atomic<bool> isBuilding_ = false;
+    std::atomic<bool> isReady_ = false;
+
+    // SongDetails refreshed its data while the index was being built, so the build has to start over
+    std::atomic<bool> isRebuildRequested_ = false;
+
+    void startBuild();
+
+    /**
+     * Drops the index, which may point to songs that no longer exist, and builds it again.
+     */
+    void rebuildAsync();
+
+    void build(const SongDetailsCache::SongDetails& songDetails);
+};
+
+}// namespace AirbudsSearch
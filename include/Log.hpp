@@ -1,9 +1,30 @@
 #pragma once
 
+#ifdef QUEST
 #include "paper2_scotland2/shared/logger.hpp"
+#endif
 
 namespace AirbudsSearch {
 
+#ifdef QUEST
 constexpr Paper::ConstLoggerContext Log = Paper::ConstLoggerContext("airbuds-search");
+#else
+// Desktop builds of the search core don't log. Logging would only add noise to benchmarks.
+struct NullLogger {
+    template<typename... TArgs>
+    void debug(TArgs&&...) const {}
+
+    template<typename... TArgs>
+    void info(TArgs&&...) const {}
+
+    template<typename... TArgs>
+    void warn(TArgs&&...) const {}
+
+    template<typename... TArgs>
+    void error(TArgs&&...) const {}
+};
+
+constexpr NullLogger Log{};
+#endif
 
 }
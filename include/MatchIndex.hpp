@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Airbuds/Track.hpp"
+#include "TrackMatcher.hpp"
+
+namespace AirbudsSearch {
+
+/**
+ * Persistent index of the best matching maps for each track in the listening history, so selecting a track can show
+ * its results without searching again. Entries are computed in the background after a history sync, using the
+ * default filter (no difficulty preference, downloaded songs included, no artist boost).
+ */
+class MatchIndex {
+
+    public:
+    static MatchIndex& getInstance() {
+        static MatchIndex matchIndex;
+        return matchIndex;
+    }
+
+    // Bump whenever a change to the queries or the scoring changes the results. Entries computed with another
+    // version are treated as stale.
+    static constexpr int SCORING_VERSION = 6;
+
+    // Number of matches stored per track. A fresh entry is shown as the final result, so selecting an indexed track
+    // lists at most this many songs, while a live search lists every match.
+    static constexpr size_t MAX_MATCHES = 20;
+
+    // Number of tracks kept. The least recently updated entries are dropped first.
+    static constexpr size_t MAX_ENTRIES = 4096;
+
+    struct StoredMatch {
+        std::string hash;
+        int score = 0;
+        int rank = 0;
+    };
+
+    struct Entry {
+        std::vector<StoredMatch> matches;
+        int scoringVersion = 0;
+
+        // Seconds since epoch
+        int64_t updatedAt = 0;
+
+        // Some of the queries failed, so the matches may be incomplete. Partial entries are always stale.
+        bool isPartial = false;
+    };
+
+    /**
+     * @return The stored entry for the track, even if it is stale.
+     */
+    std::optional<Entry> get(const std::string& trackId);
+
+    /**
+     * The entry was computed by an older scoring version or is older than the configured TTL.
+     */
+    static bool isStale(const Entry& entry);
+
+    /**
+     * Stores the matches of a track. They must have been found with the default filter. Call save() to write the
+     * index to disk.
+     */
+    void put(const std::string& trackId, const TrackMatcher::Result& result);
+
+    void save();
+
+    /**
+     * Queues the tracks that have no entry yet, or a stale one, to be matched in the background.
+     */
+    void indexTracksAsync(const std::vector<airbuds::PlaylistTrack>& tracks);
+
+    /**
+     * Looks up the stored matches in the SongDetails cache and re-ranks them for the given filter.
+     * @return The songs, best first. Songs that are no longer in the SongDetails cache are skipped.
+     */
+    static std::vector<const SongDetailsCache::Song*> resolve(const Entry& entry, const TrackMatcher::Options& options);
+
+    private:
+    std::mutex mutex_;
+
+    // Held for a whole save, so concurrent saves can't rename an older snapshot over a newer one
+    std::mutex fileMutex_;
+
+    std::unordered_map<std::string, Entry> entries_;
+    bool isLoaded_ = false;
+    bool isDirty_ = false;
+
+    static std::filesystem::path getPath();
+
+    void load();
+};
+
+}// namespace AirbudsSearch
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace AirbudsSearch::Normalization {
+
+/**
+ * Folds the text so that spellings which only differ in width, case, accents or kana script compare equal:
+ * - Full-width ASCII and half-width katakana are converted to their normal width, the ideographic space to a space
+ * - Latin letters lose their diacritics and ligatures and digraphs are split ("Beyoncé" / "beyonce", "Æ" / "ae"),
+ *   Latin letters without a base letter ("Þ", "Ŋ", "Ə") are only case folded
+ * - Greek, Cyrillic and Armenian letters are case folded, Greek also loses its accents
+ * - Katakana is converted to hiragana, and separate voiced sound marks are merged into the kana before them
+ * - Combining diacritics are dropped
+ *
+ * Case folding is the simple case folding of Unicode (CaseFolding.txt, status C and S), but only for ASCII, Latin-1
+ * Supplement, Latin Extended-A and B, Latin Extended Additional, Greek, Cyrillic, Cyrillic Supplement and Armenian.
+ * Other cased scripts, like Greek Extended, Georgian, Cherokee or Latin Extended-C and D, are not folded. Anything
+ * else is copied unchanged, including invalid UTF-8.
+ * @param output Must have room for text.size() bytes. Folding never makes the text longer.
+ * @return The number of bytes written.
+ */
+size_t foldForMatching(std::string_view text, char* output);
+
+/**
+ * The folded form of a text, kept on the stack unless the text is long. Build it once per string, right before
+ * tokenizing it.
+ */
+class FoldedText {
+
+    public:
+    explicit FoldedText(const std::string_view text) {
+        char* output = inlineBuffer_.data();
+        if (text.size() > inlineBuffer_.size()) {
+            heapBuffer_.resize(text.size());
+            output = heapBuffer_.data();
+        }
+        view_ = std::string_view(output, foldForMatching(text, output));
+    }
+
+    FoldedText(const FoldedText&) = delete;
+    FoldedText& operator=(const FoldedText&) = delete;
+
+    std::string_view view() const {
+        return view_;
+    }
+
+    private:
+    std::array<char, 256> inlineBuffer_;
+    std::string heapBuffer_;
+    std::string_view view_;
+};
+
+}// namespace AirbudsSearch::Normalization
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace AirbudsSearch {
+
+/**
+ * Spaces out requests evenly so that no more than a given number start per minute, across every thread that shares
+ * the limiter.
+ */
+class RateLimiter {
+
+    public:
+    explicit RateLimiter(const size_t requestsPerMinute)
+        : interval_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::minutes(1)) / std::max<size_t>(requestsPerMinute, 1)) {}
+
+    /**
+     * Blocks until the next request may start.
+     */
+    void acquire() {
+        std::chrono::steady_clock::time_point slot;
+        {
+            std::lock_guard lock(mutex_);
+            slot = std::max(std::chrono::steady_clock::now(), nextSlot_);
+            nextSlot_ = slot + interval_;
+        }
+        std::this_thread::sleep_until(slot);
+    }
+
+    private:
+    const std::chrono::steady_clock::duration interval_;
+    std::mutex mutex_;
+    std::chrono::steady_clock::time_point nextSlot_;
+};
+
+}// namespace AirbudsSearch
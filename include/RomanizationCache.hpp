@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace AirbudsSearch {
+
+/**
+ * Bounded cache of romanized text, shared by every thread that scores search candidates. The least recently used
+ * entries are dropped once the cache is full.
+ *
+ * Every lookup passes the version of the romanization inputs (romanizer, romaji overrides and Japanese converter).
+ * When it changes, the cache is cleared. The cache is kept on disk between launches, and only loaded back if it was
+ * written with the same version, so known titles never go through the converter again.
+ */
+class RomanizationCache {
+
+    public:
+    static RomanizationCache& getInstance() {
+        static RomanizationCache romanizationCache;
+        return romanizationCache;
+    }
+
+    // Enough for the whole listening history of the user and their friends
+    static constexpr size_t MAX_ENTRIES = 16384;
+
+    std::optional<std::string> get(const std::string& text, uint64_t version);
+
+    void put(const std::string& text, const std::string& romaji, uint64_t version);
+
+    /**
+     * Writes the cache to disk if it changed since it was loaded or last saved.
+     */
+    void save();
+
+    private:
+    struct Entry {
+        std::string text;
+        std::string romaji;
+    };
+
+    std::mutex mutex_;
+
+    // Held for a whole save, so concurrent saves can't rename an older snapshot over a newer one
+    std::mutex fileMutex_;
+
+    // Most recently used first. The index keys point into the list entries, which never move.
+    std::list<Entry> entries_;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+    uint64_t version_ = 0;
+    bool isLoaded_ = false;
+    bool isDirty_ = false;
+
+    static std::filesystem::path getPath();
+
+    // Must be called with mutex_ held
+    void setVersion(uint64_t version);
+
+    // Must be called with mutex_ held
+    void load(uint64_t version);
+};
+
+}// namespace AirbudsSearch
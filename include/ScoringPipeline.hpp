@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Filter.hpp"
+#include "FuzzyMatch.hpp"
+#include "SearchCandidate.hpp"
+#include "TokenizedText.hpp"
+
+namespace AirbudsSearch::Scoring {
+
+/**
+ * Weights of the scoring stages. Profiles are constexpr template arguments, so every pipeline is compiled for its
+ * weights and stages with a zero weight disappear entirely.
+ */
+struct WeightProfile {
+    // Multiplies the best name score (exact words or fuzzy similarity)
+    int nameWeight = 2;
+
+    // Multiplies the best artist score
+    int artistWeight = 1;
+
+    // Added once if any artist matches at all
+    int artistMatchBonus = 0;
+
+    // Added to candidates that have one of the preferred difficulties
+    int difficultyBonus = Filter::DIFFICULTY_BONUS;
+
+    // The rating (0-1) is multiplied by this, and capped at maxRatingBonus
+    int ratingWeight = 10;
+    int maxRatingBonus = 50;
+
+    // Names that are this similar (0-100) are considered fuzzy matches, and score similarity * fuzzyNameWeight. Even
+    // identical names after normalization stay below an exact match.
+    int fuzzyNameMinSimilarity = 75;
+    int fuzzyNameWeight = 4;
+};
+
+inline constexpr WeightProfile DEFAULT_PROFILE{};
+
+// Used when showing all songs by the artist of the track
+inline constexpr WeightProfile ARTIST_BOOST_PROFILE{.artistMatchBonus = 200};
+
+/**
+ * Candidates prepared for scoring, stored column by column so each stage walks one contiguous array. Every field is
+ * tokenized and normalized once when the candidate is added.
+ */
+class CandidateBatch {
+
+    public:
+    /**
+     * @param trackInfo The track the candidates will be scored against. Candidate names are only romanized if the
+     * track has a romaji name to compare them with.
+     */
+    explicit CandidateBatch(const Filter::TrackMatchInfo& trackInfo);
+
+    void reserve(size_t count);
+
+    void addSearchCandidate(const BeatSaverSearch::SearchCandidate& candidate, bool hasDifficulty);
+
+    void add(
+        const std::string& songName,
+        const std::string& mapName,
+        const std::string& songAuthor,
+        const std::string& levelAuthor,
+        float rating,
+        bool hasDifficulty);
+
+    size_t size() const {
+        return ratings.size();
+    }
+
+    // Missing fields are left empty, which never matches anything
+    std::vector<TokenizedText> songNameTokens;
+    std::vector<TokenizedText> mapNameTokens;
+    std::vector<TokenizedText> songNameRomajiTokens;
+    std::vector<FuzzyMatch::NormalizedText> songNameTexts;
+    std::vector<FuzzyMatch::NormalizedText> mapNameTexts;
+    std::vector<FuzzyMatch::NormalizedText> songNameRomajiTexts;
+    std::vector<TokenizedText> songAuthorTokens;
+    std::vector<TokenizedText> levelAuthorTokens;
+    std::vector<float> ratings;
+    std::vector<uint8_t> hasPreferredDifficulty;
+
+    private:
+    bool isRomanizingNames_;
+};
+
+// Each stage adds its part of the score of every candidate in the batch
+
+template<const WeightProfile& Profile>
+struct NameStage {
+    static void apply(const Filter::TrackMatchInfo& trackInfo, const CandidateBatch& batch, const std::span<int> scores) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            int nameScore = std::max({
+                Filter::scoreTextMatch(trackInfo.nameTokens, batch.songNameTokens[i]),
+                Filter::scoreTextMatch(trackInfo.nameTokens, batch.mapNameTokens[i]),
+                Filter::scoreTextMatch(trackInfo.romajiTokens, batch.songNameTokens[i]),
+                Filter::scoreTextMatch(trackInfo.romajiTokens, batch.songNameRomajiTokens[i]),
+            });
+
+            // The fuzzy similarity catches spelling variants ("Remix" / "Rmx"), punctuation and typos that share no
+            // exact word
+            const int similarity = std::max({
+                FuzzyMatch::getSimilarity(trackInfo.namePattern, batch.songNameTexts[i]),
+                FuzzyMatch::getSimilarity(trackInfo.namePattern, batch.mapNameTexts[i]),
+                FuzzyMatch::getSimilarity(trackInfo.romajiPattern, batch.songNameTexts[i]),
+                FuzzyMatch::getSimilarity(trackInfo.romajiPattern, batch.songNameRomajiTexts[i]),
+            });
+            if (similarity >= Profile.fuzzyNameMinSimilarity) {
+                nameScore = std::max(nameScore, similarity * Profile.fuzzyNameWeight);
+            }
+            scores[i] += nameScore * Profile.nameWeight;
+        }
+    }
+};
+
+template<const WeightProfile& Profile>
+struct ArtistStage {
+    static void apply(const Filter::TrackMatchInfo& trackInfo, const CandidateBatch& batch, const std::span<int> scores) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            int artistScore = 0;
+            for (const Filter::ArtistMatchInfo& artist : trackInfo.artists) {
+                artistScore = std::max({
+                    artistScore,
+                    Filter::scoreTextMatch(artist.nameTokens, batch.songAuthorTokens[i]),
+                    Filter::scoreTextMatch(artist.nameTokens, batch.levelAuthorTokens[i]),
+                    Filter::scoreTextMatch(artist.romajiTokens, batch.songAuthorTokens[i]),
+                    Filter::scoreTextMatch(artist.romajiTokens, batch.levelAuthorTokens[i]),
+                });
+            }
+            scores[i] += artistScore * Profile.artistWeight;
+            if constexpr (Profile.artistMatchBonus != 0) {
+                if (artistScore > 0) {
+                    scores[i] += Profile.artistMatchBonus;
+                }
+            }
+        }
+    }
+};
+
+template<const WeightProfile& Profile>
+struct DifficultyStage {
+    static void apply(const Filter::TrackMatchInfo&, const CandidateBatch& batch, const std::span<int> scores) {
+        if constexpr (Profile.difficultyBonus != 0) {
+            for (size_t i = 0; i < batch.size(); ++i) {
+                scores[i] += batch.hasPreferredDifficulty[i] ? Profile.difficultyBonus : 0;
+            }
+        }
+    }
+};
+
+template<const WeightProfile& Profile>
+struct RatingStage {
+    static void apply(const Filter::TrackMatchInfo&, const CandidateBatch& batch, const std::span<int> scores) {
+        if constexpr (Profile.ratingWeight != 0) {
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const float rating = batch.ratings[i];
+                if (rating > 0.0f) {
+                    scores[i] += std::clamp(static_cast<int>(rating * static_cast<float>(Profile.ratingWeight)), 0, Profile.maxRatingBonus);
+                }
+            }
+        }
+    }
+};
+
+/**
+ * Runs the stages one after the other over the whole batch. The stages are resolved at compile time, so scoring a
+ * candidate involves no indirect calls.
+ */
+template<typename... Stages>
+struct Pipeline {
+    static void score(const Filter::TrackMatchInfo& trackInfo, const CandidateBatch& batch, const std::span<int> scores) {
+        std::fill_n(scores.begin(), batch.size(), 0);
+        (Stages::apply(trackInfo, batch, scores), ...);
+    }
+};
+
+template<const WeightProfile& Profile>
+using MatchPipeline = Pipeline<NameStage<Profile>, ArtistStage<Profile>, DifficultyStage<Profile>, RatingStage<Profile>>;
+
+/**
+ * Highest match score the pipeline can give any candidate for this track: an exact name and artist, the difficulty
+ * bonus and the highest rating bonus. The fuzzy name score always stays below an exact name.
+ */
+template<const WeightProfile& Profile>
+int getMaxMatchScore(const Filter::TrackMatchInfo& trackInfo, const bool hasPreferredDifficulties) {
+    const int nameScore = std::max(Filter::getMaxTextMatchScore(trackInfo.nameTokens), Filter::getMaxTextMatchScore(trackInfo.romajiTokens));
+    int artistScore = 0;
+    for (const Filter::ArtistMatchInfo& artist : trackInfo.artists) {
+        artistScore = std::max({artistScore, Filter::getMaxTextMatchScore(artist.nameTokens), Filter::getMaxTextMatchScore(artist.romajiTokens)});
+    }
+    int score = nameScore * Profile.nameWeight + artistScore * Profile.artistWeight;
+    if (artistScore > 0) {
+        score += Profile.artistMatchBonus;
+    }
+    if (hasPreferredDifficulties) {
+        score += Profile.difficultyBonus;
+    }
+    if (Profile.ratingWeight != 0) {
+        score += Profile.maxRatingBonus;
+    }
+    return score;
+}
+
+inline int getMaxMatchScore(const Filter::TrackMatchInfo& trackInfo, const bool artistBoost, const bool hasPreferredDifficulties) {
+    if (artistBoost) {
+        return getMaxMatchScore<ARTIST_BOOST_PROFILE>(trackInfo, hasPreferredDifficulties);
+    }
+    return getMaxMatchScore<DEFAULT_PROFILE>(trackInfo, hasPreferredDifficulties);
+}
+
+/**
+ * Scores every candidate of the batch against the track. The pipeline is picked once for the whole batch.
+ * @return The match score of each candidate, in the order they were added.
+ */
+inline std::vector<int> scoreBatch(const Filter::TrackMatchInfo& trackInfo, const CandidateBatch& batch, const bool artistBoost) {
+    std::vector<int> scores(batch.size());
+    if (artistBoost) {
+        MatchPipeline<ARTIST_BOOST_PROFILE>::score(trackInfo, batch, scores);
+    } else {
+        MatchPipeline<DEFAULT_PROFILE>::score(trackInfo, batch, scores);
+    }
+    return scores;
+}
+
+/**
+ * Final score of a search result: the base score of the query that found it and its match score, minus its position
+ * in the results of that query.
+ */
+inline int getResultScore(const int baseScore, const int matchScore, const size_t position) {
+    return baseScore + matchScore - static_cast<int>(position);
+}
+
+/**
+ * Breaks ties between results with the same score: earlier queries first, then earlier positions. Lower is better.
+ * Positions must stay below 100, so every (query, position) pair gets its own rank.
+ */
+inline int getResultRank(const size_t queryIndex, const size_t position) {
+    return static_cast<int>(queryIndex * 100 + position);
+}
+
+}// namespace AirbudsSearch::Scoring
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace AirbudsSearch::BeatSaverSearch {
+
+/**
+ * The fields of a BeatSaver search result that matching needs, extracted straight from the response without building
+ * the full beatmap model.
+ */
+struct SearchCandidate {
+    std::string id;
+    std::string name;
+    std::string songName;
+    std::string songAuthorName;
+    std::string levelAuthorName;
+
+    // Rating between 0 and 1
+    float score = 0.0f;
+
+    // Of the latest version. The hash is empty if the map has no version.
+    std::string hash;
+    std::optional<std::string> key;
+
+    // Bit i is set if the latest version has a difficulty whose SongDetailsCache::MapDifficulty value is i, in any
+    // characteristic
+    uint8_t difficultyMask = 0;
+};
+
+}// namespace AirbudsSearch::BeatSaverSearch
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "Airbuds/Track.hpp"
+#include "CancellationToken.hpp"
+
+namespace AirbudsSearch {
+
+/**
+ * Runs the BeatSaver search queries of tracks the user is likely to select next, so their responses are already in
+ * the SearchResponseCache. Prefetching runs on a single low-priority thread, pauses while a foreground search is
+ * running and only runs while the history list is visible.
+ *
+ * The same thread also fills the MatchIndex once there is nothing left to prefetch, and writes it to disk.
+ */
+class SearchPrefetcher {
+
+    public:
+    static SearchPrefetcher& getInstance() {
+        static SearchPrefetcher searchPrefetcher;
+        return searchPrefetcher;
+    }
+
+    /**
+     * Replaces the tracks waiting to be prefetched. Tracks are processed in order.
+     */
+    void setTracks(std::vector<airbuds::Track> tracks);
+
+    /**
+     * Queues tracks to be matched and stored in the MatchIndex. Unlike prefetched tracks, these are kept while
+     * prefetching is disabled and processed once it is enabled again.
+     */
+    void addIndexTracks(std::vector<airbuds::Track> tracks);
+
+    /**
+     * Counts an entry that was stored in the MatchIndex outside of the prefetcher, e.g. by a foreground search. The
+     * index is written to disk by the prefetcher thread once enough entries are unsaved, instead of after every search.
+     */
+    void addUnsavedIndexEntry();
+
+    /**
+     * Enables or disables prefetching, e.g. when the history list is shown or hidden. Disabling aborts the current
+     * request and drops the pending tracks.
+     */
+    void setActive(bool isActive);
+
+    void beginForegroundSearch();
+
+    void endForegroundSearch();
+
+    private:
+    std::mutex mutex_;
+    std::condition_variable conditionVariable_;
+    std::deque<airbuds::Track> pendingTracks_;
+    std::deque<airbuds::Track> pendingIndexTracks_;
+    size_t foregroundSearchCount_ = 0;
+    size_t unsavedIndexEntryCount_ = 0;
+    bool isIndexSavePending_ = false;
+    bool isActive_ = false;
+    bool isThreadRunning_ = false;
+    CancellationToken cancellationToken_;
+
+    bool canRun() const;
+
+    bool hasWork() const;
+
+    void startThreadIfNeeded();
+
+    void run();
+
+    // Both return with the lock held
+    void prefetch(std::unique_lock<std::mutex>& lock);
+
+    void index(std::unique_lock<std::mutex>& lock);
+
+    void saveIndex(std::unique_lock<std::mutex>& lock);
+};
+
+/**
+ * Pauses prefetching for as long as it is alive.
+ */
+class ForegroundSearchScope {
+    public:
+    ForegroundSearchScope() {
+        SearchPrefetcher::getInstance().beginForegroundSearch();
+    }
+
+    ~ForegroundSearchScope() {
+        SearchPrefetcher::getInstance().endForegroundSearch();
+    }
+
+    ForegroundSearchScope(const ForegroundSearchScope&) = delete;
+    ForegroundSearchScope& operator=(const ForegroundSearchScope&) = delete;
+};
+
+}// namespace AirbudsSearch
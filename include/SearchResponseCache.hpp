@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+namespace AirbudsSearch {
+
+/**
+ * Disk cache for BeatSaver search responses, stored in the "cache/search" subdirectory of the data directory so the
+ * existing "Clear Cache" setting also clears it.
+ */
+class SearchResponseCache {
+
+    public:
+    static SearchResponseCache& getInstance() {
+        static SearchResponseCache searchResponseCache;
+        return searchResponseCache;
+    }
+
+    struct Entry {
+        std::string body;
+
+        // The entry is older than the configured TTL and should be refreshed
+        bool isStale = false;
+    };
+
+    std::optional<Entry> get(const std::string& key);
+
+    void put(const std::string& key, const std::string& body);
+
+    /**
+     * Marks the key as being refreshed.
+     * @return false if the key is already being refreshed by another thread.
+     */
+    bool beginRevalidation(const std::string& key);
+
+    void endRevalidation(const std::string& key);
+
+    private:
+    // Stale entries are served while they are refreshed, but not forever
+    static constexpr std::chrono::hours MAX_STALE_AGE{24 * 30};
+
+    std::mutex mutex_;
+    std::optional<uintmax_t> totalSizeInBytes_;
+    std::unordered_set<std::string> revalidatingKeys_;
+
+    static std::filesystem::path getCacheDirectory();
+
+    static std::filesystem::path getPath(const std::string& key);
+
+    uintmax_t getTotalSizeInBytes();
+
+    void evict(uintmax_t maxSizeInBytes);
+};
+
+}// namespace AirbudsSearch
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "CancellationToken.hpp"
+
+namespace AirbudsSearch {
+
+/**
+ * Coalesces concurrent calls that share a key. The first caller runs the function, and callers that arrive while it is
+ * still running wait for it and get a copy of its result instead of running it again. Nothing is cached: once the call
+ * finishes, the next caller with the same key runs the function again.
+ */
+template<typename Result>
+class SingleFlight {
+
+    public:
+    /**
+     * @param cancellationToken Only stops waiting for a call started by another caller. A call started by this caller
+     * has to observe the token itself.
+     * @return The result of the function, or nothing if the token was cancelled while waiting for another caller.
+     */
+    template<typename Function>
+    std::optional<Result> run(const std::string& key, const CancellationToken& cancellationToken, Function&& function) {
+        std::promise<Result> promise;
+        std::shared_future<Result> future;
+        bool isLeader = false;
+        {
+            std::lock_guard lock(mutex_);
+            const auto it = calls_.find(key);
+            if (it != calls_.end()) {
+                future = it->second;
+            } else {
+                future = promise.get_future().share();
+                calls_.emplace(key, future);
+                isLeader = true;
+            }
+        }
+
+        if (!isLeader) {
+            while (future.wait_for(WAIT_POLL_INTERVAL) != std::future_status::ready) {
+                if (cancellationToken.isCancelled()) {
+                    return std::nullopt;
+                }
+            }
+            return future.get();
+        }
+
+        // Remove the call before publishing the result, so a caller that arrives afterwards starts a fresh one
+        // instead of joining a call that already finished
+        try {
+            Result result = std::forward<Function>(function)();
+            removeCall(key);
+            promise.set_value(result);
+            return result;
+        } catch (...) {
+            removeCall(key);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    /**
+     * Same as run(), for callers that can't be cancelled.
+     */
+    template<typename Function>
+    Result run(const std::string& key, Function&& function) {
+        return *run(key, CancellationToken(), std::forward<Function>(function));
+    }
+
+    private:
+    // How often a waiting caller checks its cancellation token
+    static constexpr std::chrono::milliseconds WAIT_POLL_INTERVAL{50};
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_future<Result>> calls_;
+
+    void removeCall(const std::string& key) {
+        std::lock_guard lock(mutex_);
+        calls_.erase(key);
+    }
+};
+
+}// namespace AirbudsSearch
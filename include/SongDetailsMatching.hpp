@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include "song-details/shared/SongDetails.hpp"
+
+#include "ScoringPipeline.hpp"
+#include "SearchCandidate.hpp"
+
+namespace AirbudsSearch::Filter {
+
+// Matching helpers that need the SongDetails cache. They are kept out of the search core (see Filter.hpp) so that it
+// builds without the game.
+
+bool candidateHasDifficulty(const BeatSaverSearch::SearchCandidate& candidate, const std::vector<SongDetailsCache::MapDifficulty>& difficulties);
+
+bool songHasDifficulty(const SongDetailsCache::Song& song, const std::vector<SongDetailsCache::MapDifficulty>& difficulties);
+
+/**
+ * Adds a song from the local SongDetails cache to the batch.
+ */
+void addSongCandidate(Scoring::CandidateBatch& batch, const SongDetailsCache::Song& song, bool hasDifficulty);
+
+}// namespace AirbudsSearch::Filter
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace AirbudsSearch {
+
+/**
+ * The words of a piece of text, stored as hashes in a fixed-size array so that it can be built and compared without
+ * allocating. Build it once per track, artist or candidate field with Filter::tokenize() and reuse it for every
+ * comparison.
+ */
+class TokenizedText {
+
+    public:
+    // Words past this limit are ignored. Song names and artists are far shorter in practice.
+    static constexpr size_t MAX_TOKENS = 24;
+
+    struct Token {
+        uint64_t hash = 0;
+
+        // Length of the word in bytes
+        uint32_t length = 0;
+
+        // Pair of adjacent Japanese characters, see Filter::tokenize()
+        bool isBigram = false;
+    };
+
+    TokenizedText() = default;
+
+    /**
+     * @param textHash Hash of the whole lowercase text, used to detect exact matches.
+     * @param textLength Length of the whole text in bytes.
+     */
+    TokenizedText(const uint64_t textHash, const size_t textLength, const std::span<const Token> tokens)
+        : textHash_(textHash), textLength_(textLength) {
+        tokenCount_ = std::min(tokens.size(), MAX_TOKENS);
+        std::copy_n(tokens.begin(), tokenCount_, tokens_.begin());
+        std::sort(tokens_.begin(), tokens_.begin() + tokenCount_, [](const Token& a, const Token& b) {
+            return a.hash < b.hash;
+        });
+    }
+
+    bool isTextEmpty() const {
+        return textLength_ == 0;
+    }
+
+    bool isSameText(const TokenizedText& other) const {
+        return textLength_ == other.textLength_ && textHash_ == other.textHash_;
+    }
+
+    /**
+     * @return The tokens sorted by hash. Repeated words appear once per occurrence.
+     */
+    std::span<const Token> getTokens() const {
+        return {tokens_.data(), tokenCount_};
+    }
+
+    private:
+    std::array<Token, MAX_TOKENS> tokens_{};
+    size_t tokenCount_ = 0;
+    uint64_t textHash_ = 0;
+    size_t textLength_ = 0;
+};
+
+}// namespace AirbudsSearch
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "song-details/shared/SongDetails.hpp"
+
+#include "Airbuds/Track.hpp"
+#include "CancellationToken.hpp"
+
+namespace AirbudsSearch::TrackMatcher {
+
+struct Options {
+    std::vector<SongDetailsCache::MapDifficulty> difficulties;
+    bool includeDownloadedSongs = true;
+    bool artistBoost = false;
+    bool onlineSearch = true;
+};
+
+struct Match {
+    const SongDetailsCache::Song* song = nullptr;
+    int score = 0;
+
+    // Tie-breaker for equal scores, lower is better. Derived from the query order and the position in its results.
+    int rank = 0;
+};
+
+struct Result {
+    // Best match first
+    std::vector<Match> matches;
+    size_t queryCount = 0;
+    bool hadAnySuccess = false;
+
+    // Some of the queries failed, so the matches may be incomplete
+    bool hadAnyFailure = false;
+    bool cancelled = false;
+};
+
+/**
+ * Receives the best matches found so far while some of the queries are still running. The callback runs on whichever
+ * search thread produced the matches, so calls can overlap and finish out of order. `sequence` grows with every
+ * snapshot: matches with a lower sequence than ones already received are older and should be dropped.
+ */
+using PartialResultsCallback = std::function<void(const std::vector<Match>& matches, uint64_t sequence)>;
+
+bool isBetterMatch(const Match& a, const Match& b);
+
+/**
+ * Finds the maps that best match a track using the local song index and the BeatSaver search API. Blocks until every
+ * query has finished or the search is cancelled.
+ * @param onPartialResults Optional. Called from the search threads with up to `partialResultCount` matches.
+ */
+Result findMatches(
+    const airbuds::Track& track,
+    const Options& options,
+    const CancellationToken& cancellationToken,
+    const PartialResultsCallback& onPartialResults = nullptr,
+    size_t partialResultCount = 20);
+
+}// namespace AirbudsSearch::TrackMatcher
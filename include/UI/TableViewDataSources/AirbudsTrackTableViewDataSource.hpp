@@ -40,6 +40,12 @@ DECLARE_CLASS_CODEGEN_INTERFACES(AirbudsSearch::UI, AirbudsTrackTableViewDataSou
     int getRowIndexForTrackIndex(size_t trackIndex) const;
     int getRowIndexForTrack(const airbuds::PlaylistTrack& track) const;
 
+    /**
+     * Collects up to `count` tracks after and up to `count` tracks before the given row, closest first. Tracks
+     * directly below the row come before tracks directly above it.
+     */
+    std::vector<airbuds::PlaylistTrack> getTracksAroundRow(int idx, size_t count) const;
+
     private:
     std::vector<airbuds::PlaylistTrack> tracks_;
     std::vector<Row> rows_;
@@ -15,4 +15,11 @@ DECLARE_CLASS_CODEGEN_INTERFACES(AirbudsSearch::UI, CustomSongTableViewDataSourc
 
     public:
     void setSource(const std::vector<const SongDetailsCache::Song*>& source);
+
+    /**
+     * Replaces the source only if it differs from the current one. The whole list is replaced, not diffed row by row:
+     * the caller reloads the table view and restores the scroll position and selection.
+     * @return true if the source changed and the table view needs to be reloaded.
+     */
+    bool updateSource(const std::vector<const SongDetailsCache::Song*>& source);
 };
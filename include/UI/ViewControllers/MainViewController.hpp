@@ -12,7 +12,9 @@
 #include "custom-types/shared/macros.hpp"
 #include "song-details/shared/SongDetails.hpp"
 
+#include "CancellationToken.hpp"
 #include "CustomSongFilter.hpp"
+#include "Filter.hpp"
 #include "Airbuds/AirbudsClient.hpp"
 #include "UI/TableViewDataSources/DownloadHistoryTableViewDataSource.hpp"
 
@@ -24,21 +26,12 @@ using BaseViewController = BSML::HotReloadViewController;
 using BaseViewController = HMUI::ViewController;
 #endif
 
-namespace AirbudsSearch::Filter {
-
-using SongFilterFunction = std::function<bool(const SongDetailsCache::Song* const song, const airbuds::Track& track)>;
-using SongScoreFunction = std::function<int(const airbuds::Track& track, const SongDetailsCache::Song& song)>;
-
-extern SongFilterFunction DEFAULT_SONG_FILTER_FUNCTION;
-extern SongScoreFunction DEFAULT_SONG_SCORE_FUNCTION;
-
-} // namespace AirbudsSearch::Filter
-
 DECLARE_CLASS_CODEGEN_INTERFACES(AirbudsSearch::UI::ViewControllers, MainViewController, BaseViewController) {
 
     DECLARE_CTOR(ctor);
 
     DECLARE_OVERRIDE_METHOD_MATCH(void, DidActivate, &HMUI::ViewController::DidActivate, bool isFirstActivation, bool addedToHierarchy, bool screenSystemDisabling);
+    DECLARE_OVERRIDE_METHOD_MATCH(void, DidDeactivate, &HMUI::ViewController::DidDeactivate, bool removedFromHierarchy, bool screenSystemDisabling);
 
     DECLARE_INSTANCE_METHOD(void, PostParse);
 
@@ -108,6 +101,7 @@ DECLARE_CLASS_CODEGEN_INTERFACES(AirbudsSearch::UI::ViewControllers, MainViewCon
 
     std::unique_ptr<airbuds::Playlist> selectedPlaylist_;
     std::unique_ptr<const airbuds::Track> selectedTrack_;
+    int selectedTrackRow_;
     std::optional<airbuds::Friend> selectedFriend_;
 
     std::queue<std::shared_ptr<DownloadHistoryItem>> pendingDownloads_;
@@ -117,6 +111,12 @@ DECLARE_CLASS_CODEGEN_INTERFACES(AirbudsSearch::UI::ViewControllers, MainViewCon
     std::atomic<bool> isLoadingMoreAirbudsTracks_;
     std::atomic<bool> isLoadingMoreAirbudsPlaylists_;
     std::atomic<bool> isSearchInProgress_;
+    std::atomic<uint64_t> searchGeneration_;
+    bool hasPublishedSearchResults_;
+
+    // Sequence of the newest partial results shown for the current search
+    uint64_t publishedPartialResultSequence_;
+    AirbudsSearch::CancellationToken searchCancellationToken_;
 
     std::atomic<bool> isShowingAllTracksByArtist_;
     std::atomic<bool> isShowingDownloadedMaps_{true};
@@ -129,9 +129,6 @@ DECLARE_CLASS_CODEGEN_INTERFACES(AirbudsSearch::UI::ViewControllers, MainViewCon
     bool randomAcrossAllDays_;
     std::optional<airbuds::PlaylistTrack> pendingRandomTrack_;
 
-    AirbudsSearch::Filter::SongFilterFunction currentSongFilter_;
-    AirbudsSearch::Filter::SongScoreFunction currentSongScore_;
-
     void reloadAirbudsTrackListView();
     void reloadAirbudsPlaylistListView();
     bool selectPlaylistById(std::string_view playlistId);
@@ -148,6 +145,15 @@ DECLARE_CLASS_CODEGEN_INTERFACES(AirbudsSearch::UI::ViewControllers, MainViewCon
     void onAirbudsTrackLoadingError(const std::string& message);
 
     void doSongSearch(const airbuds::Track& track);
+    void cancelSongSearch();
+    void prefetchNeighbourTracks();
+    void publishSearchResults(
+        uint64_t searchGeneration,
+        uint64_t partialResultSequence,
+        const airbuds::Track& track,
+        const std::vector<const SongDetailsCache::Song*>& songs,
+        bool isFinal,
+        bool showSearchError);
 
     CustomSongFilter customSongFilter_;
 
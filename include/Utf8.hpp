@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace AirbudsSearch::Utf8 {
+
+/**
+ * @return The number of ASCII bytes at the start of the text. Checks 16 bytes at a time with NEON or SSE2 where
+ * available, 8 at a time otherwise.
+ */
+inline size_t countAsciiPrefix(const std::string_view text) {
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t size = text.size();
+    size_t i = 0;
+#if defined(__aarch64__) && defined(__ARM_NEON)
+    for (; i + 16 <= size; i += 16) {
+        if (vmaxvq_u8(vld1q_u8(data + i)) >= 0x80) {
+            break;
+        }
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        const int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        if (mask != 0) {
+            return i + static_cast<size_t>(std::countr_zero(static_cast<unsigned int>(mask)));
+        }
+    }
+#else
+    for (; i + 8 <= size; i += 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, data + i, sizeof(chunk));
+        if ((chunk & 0x8080808080808080ULL) != 0) {
+            break;
+        }
+    }
+#endif
+    while (i < size && data[i] < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+inline bool isAscii(const std::string_view text) {
+    return countAsciiPrefix(text) == text.size();
+}
+
+/**
+ * Decodes the multibyte sequence that starts at the index. Continuation bytes aren't validated, a truncated sequence
+ * or a stray continuation byte is invalid.
+ * @return The length of the sequence in bytes, or 0 if it is invalid.
+ */
+inline size_t decodeCodepoint(const std::string_view text, const size_t index, uint32_t& codepoint) {
+    const auto byteAt = [&text](const size_t i) {
+        return static_cast<uint32_t>(static_cast<unsigned char>(text[i]));
+    };
+    const uint32_t c = byteAt(index);
+    if (c < 0x80) {
+        codepoint = c;
+        return 1;
+    }
+    if ((c & 0xE0) == 0xC0 && index + 1 < text.size()) {
+        codepoint = ((c & 0x1F) << 6) | (byteAt(index + 1) & 0x3F);
+        return 2;
+    }
+    if ((c & 0xF0) == 0xE0 && index + 2 < text.size()) {
+        codepoint = ((c & 0x0F) << 12) | ((byteAt(index + 1) & 0x3F) << 6) | (byteAt(index + 2) & 0x3F);
+        return 3;
+    }
+    if ((c & 0xF8) == 0xF0 && index + 3 < text.size()) {
+        codepoint = ((c & 0x07) << 18) | ((byteAt(index + 1) & 0x3F) << 12) | ((byteAt(index + 2) & 0x3F) << 6) | (byteAt(index + 3) & 0x3F);
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * @return The length of the encoded codepoint in bytes.
+ */
+inline size_t encodeCodepoint(const uint32_t codepoint, std::array<char, 4>& encoded) {
+    if (codepoint <= 0x7F) {
+        encoded[0] = static_cast<char>(codepoint);
+        return 1;
+    }
+    if (codepoint <= 0x7FF) {
+        encoded[0] = static_cast<char>(0xC0 | (codepoint >> 6));
+        encoded[1] = static_cast<char>(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint <= 0xFFFF) {
+        encoded[0] = static_cast<char>(0xE0 | (codepoint >> 12));
+        encoded[1] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        encoded[2] = static_cast<char>(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    encoded[0] = static_cast<char>(0xF0 | (codepoint >> 18));
+    encoded[1] = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+    encoded[2] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+    encoded[3] = static_cast<char>(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+}// namespace AirbudsSearch::Utf8
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace AirbudsSearch {
+
+/**
+ * Lowercase words stored back to back in a single buffer. Fill it with Filter::splitWords(), and clear and reuse it
+ * to split more text without allocating once the buffers have grown. The views it returns stay valid until the list
+ * is changed.
+ */
+class WordList {
+
+    public:
+    void clear() {
+        buffer_.clear();
+        words_.clear();
+        wordStart_ = 0;
+    }
+
+    size_t size() const {
+        return words_.size();
+    }
+
+    bool empty() const {
+        return words_.empty();
+    }
+
+    std::string_view operator[](const size_t index) const {
+        return std::string_view(buffer_).substr(words_[index].offset, words_[index].length);
+    }
+
+    void reserve(const size_t byteCount) {
+        buffer_.reserve(buffer_.size() + byteCount);
+    }
+
+    /**
+     * Appends bytes to the current word.
+     */
+    void append(const std::string_view bytes) {
+        buffer_.append(bytes);
+    }
+
+    void append(const char byte) {
+        buffer_.push_back(byte);
+    }
+
+    /**
+     * Ends the current word. Does nothing if the word is empty.
+     */
+    void endWord() {
+        if (buffer_.size() > wordStart_) {
+            words_.push_back(Word{static_cast<uint32_t>(wordStart_), static_cast<uint32_t>(buffer_.size() - wordStart_)});
+        }
+        wordStart_ = buffer_.size();
+    }
+
+    private:
+    // Words are stored as offsets so that the buffer can grow
+    struct Word {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::string buffer_;
+    std::vector<Word> words_;
+    size_t wordStart_ = 0;
+};
+
+}// namespace AirbudsSearch
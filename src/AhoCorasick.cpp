@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <map>
+
+#include "AhoCorasick.hpp"
+
+namespace AirbudsSearch {
+
+AhoCorasick::AhoCorasick(const std::vector<std::pair<std::string, std::string>>& replacements) {
+    // Build the trie with ordered children first, then flatten them into edges_
+    std::vector<std::map<uint8_t, uint32_t>> children(1);
+    states_.emplace_back();
+    for (const auto& [pattern, replacement] : replacements) {
+        if (pattern.empty()) {
+            continue;
+        }
+        uint32_t state = ROOT;
+        for (const char c : pattern) {
+            const uint8_t byte = static_cast<uint8_t>(c);
+            const auto it = children[state].find(byte);
+            if (it != children[state].end()) {
+                state = it->second;
+                continue;
+            }
+            const uint32_t created = static_cast<uint32_t>(states_.size());
+            State createdState;
+            createdState.depth = states_[state].depth + 1;
+            states_.push_back(createdState);
+            children.emplace_back();
+            children[state].emplace(byte, created);
+            state = created;
+        }
+        if (states_[state].pattern == NO_PATTERN) {
+            states_[state].pattern = static_cast<uint32_t>(replacements_.size());
+            replacements_.push_back(replacement);
+            patternLengths_.push_back(static_cast<uint32_t>(pattern.size()));
+        } else {
+            replacements_[states_[state].pattern] = replacement;
+        }
+    }
+
+    for (uint32_t state = 0; state < states_.size(); ++state) {
+        states_[state].edgesBegin = static_cast<uint32_t>(edges_.size());
+        for (const auto& [byte, target] : children[state]) {
+            edges_.push_back(Edge{byte, target});
+        }
+        states_[state].edgesEnd = static_cast<uint32_t>(edges_.size());
+    }
+    for (const auto& [byte, target] : children[ROOT]) {
+        rootTransitions_[byte] = target;
+    }
+
+    // Failure links, breadth first so the failure of a state is always ready before the state itself. The children
+    // of the root fail to the root.
+    std::vector<uint32_t> queue;
+    queue.reserve(states_.size());
+    for (const auto& [byte, target] : children[ROOT]) {
+        queue.push_back(target);
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const uint32_t state = queue[head];
+        State& current = states_[state];
+
+        // A pattern that ends at a suffix of this state also ends here
+        if (current.pattern == NO_PATTERN) {
+            current.pattern = states_[current.failure].pattern;
+        }
+        for (uint32_t edgeIndex = current.edgesBegin; edgeIndex < current.edgesEnd; ++edgeIndex) {
+            const Edge& edge = edges_[edgeIndex];
+            states_[edge.target].failure = next(states_[state].failure, edge.byte);
+            queue.push_back(edge.target);
+        }
+    }
+}
+
+uint32_t AhoCorasick::findEdge(const uint32_t state, const uint8_t byte) const {
+    const auto begin = edges_.begin() + states_[state].edgesBegin;
+    const auto end = edges_.begin() + states_[state].edgesEnd;
+    const auto it = std::lower_bound(begin, end, byte, [](const Edge& edge, const uint8_t value) {
+        return edge.byte < value;
+    });
+    // The root is never the target of an edge, so it stands for no edge
+    return it != end && it->byte == byte ? it->target : ROOT;
+}
+
+uint32_t AhoCorasick::next(uint32_t state, const uint8_t byte) const {
+    while (state != ROOT) {
+        const uint32_t target = findEdge(state, byte);
+        if (target != ROOT) {
+            return target;
+        }
+        state = states_[state].failure;
+    }
+    return rootTransitions_[byte];
+}
+
+std::string AhoCorasick::replaceAll(const std::string_view text) const {
+    if (replacements_.empty()) {
+        return std::string(text);
+    }
+
+    std::string output;
+    output.reserve(text.size());
+
+    // Everything before this has been written to the output
+    size_t copiedUntil = 0;
+
+    // Best match found so far that may still be beaten by a longer one, or one that starts earlier
+    bool hasMatch = false;
+    size_t matchStart = 0;
+    uint32_t matchPattern = 0;
+
+    uint32_t state = ROOT;
+    size_t i = 0;
+    while (true) {
+        // Once no match in progress can start at or before the best match, nothing can beat it anymore. Replace it
+        // and search again from its end, since matches can't overlap.
+        if (hasMatch && (i == text.size() || i - states_[state].depth > matchStart)) {
+            output.append(text.substr(copiedUntil, matchStart - copiedUntil));
+            output.append(replacements_[matchPattern]);
+            copiedUntil = matchStart + patternLengths_[matchPattern];
+            hasMatch = false;
+            state = ROOT;
+            i = copiedUntil;
+        }
+        if (i == text.size()) {
+            break;
+        }
+
+        state = next(state, static_cast<uint8_t>(text[i]));
+        ++i;
+        const uint32_t pattern = states_[state].pattern;
+        if (pattern == NO_PATTERN) {
+            continue;
+        }
+        // The longest pattern that ends here is also the one that starts first
+        const size_t start = i - patternLengths_[pattern];
+        if (!hasMatch || start < matchStart || (start == matchStart && patternLengths_[pattern] > patternLengths_[matchPattern])) {
+            hasMatch = true;
+            matchStart = start;
+            matchPattern = pattern;
+        }
+    }
+
+    output.append(text.substr(copiedUntil));
+    return output;
+}
+
+}// namespace AirbudsSearch
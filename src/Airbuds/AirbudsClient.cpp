@@ -6,13 +6,20 @@
 #include <ctime>
 #include <fstream>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <openssl/evp.h>
+#include <sys/resource.h>
 
 #include <web-utils/shared/WebUtils.hpp>
 
+#include "FileUtils.hpp"
+#include "Filter.hpp"
+#include "HttpClient.hpp"
 #include "Log.hpp"
+#include "MatchIndex.hpp"
+#include "ThreadPool.hpp"
 #include "Airbuds/Json.hpp"
 #include "Airbuds/Track.hpp"
 #include "Airbuds/Utils.hpp"
@@ -34,19 +41,6 @@ constexpr std::string_view AIRBUDS_REFRESH_ENDPOINT = "https://accounts-ilsfyhvr
 constexpr std::string_view AIRBUDS_REFRESH_CONTENT_TYPE = "application/json; charset=utf-8";
 constexpr std::string_view FRIEND_HISTORY_CACHE_DIR = "friend_recently_played";
 
-struct AccumulatingStringResponse : public WebUtils::GenericResponse<std::string> {
-    size_t totalBytes = 0;
-
-    bool AcceptData(std::span<uint8_t const> data) override {
-        totalBytes += data.size();
-        if (!responseData) {
-            responseData = std::string();
-        }
-        responseData->append(reinterpret_cast<const char*>(data.data()), data.size());
-        return true;
-    }
-};
-
 std::string trim(std::string_view value) {
     size_t start = 0;
     size_t end = value.size();
@@ -255,7 +249,12 @@ std::string getOptionalString(const rapidjson::Value& json, const char* key);
 
 struct RecentlyPlayedCache {
     std::vector<airbuds::PlaylistTrack> tracks;
-    std::chrono::milliseconds oldestTimestamp{0};
+
+    // Newest play time that has been synced. A refresh stops paging once it reaches it.
+    std::chrono::milliseconds newestTimestamp{0};
+
+    // Cursor of the next page of an interrupted backfill, or empty when the whole history has been fetched
+    std::string backfillCursor;
 };
 
 std::filesystem::path getRecentlyPlayedCachePath() {
@@ -365,13 +364,17 @@ RecentlyPlayedCache loadRecentlyPlayedCache(const std::filesystem::path& path) {
             continue;
         }
         cache.tracks.push_back(track);
-        if (track.dateAdded_.count() > 0) {
-            if (cache.oldestTimestamp.count() == 0 || track.dateAdded_ < cache.oldestTimestamp) {
-                cache.oldestTimestamp = track.dateAdded_;
-            }
+        if (track.dateAdded_ > cache.newestTimestamp) {
+            cache.newestTimestamp = track.dateAdded_;
         }
     }
 
+    // Version 1 caches have no watermark, so they fall back to the newest cached track
+    if (document.HasMember("newestTimestamp") && document["newestTimestamp"].IsInt64()) {
+        cache.newestTimestamp = std::chrono::milliseconds(document["newestTimestamp"].GetInt64());
+    }
+    cache.backfillCursor = getOptionalString(document, "backfillCursor");
+
     if (!cache.tracks.empty()) {
         std::stable_sort(cache.tracks.begin(), cache.tracks.end(), [](const auto& left, const auto& right) {
             const auto leftMillis = left.dateAdded_.count();
@@ -396,15 +399,21 @@ RecentlyPlayedCache loadRecentlyPlayedCache() {
     return loadRecentlyPlayedCache(getRecentlyPlayedCachePath());
 }
 
-void saveRecentlyPlayedCache(const std::filesystem::path& path, const std::vector<airbuds::PlaylistTrack>& tracks) {
+void saveRecentlyPlayedCache(const std::filesystem::path& path, const RecentlyPlayedCache& cache) {
 
     rapidjson::Document document;
     document.SetObject();
     auto& allocator = document.GetAllocator();
-    document.AddMember("version", 1, allocator);
+    document.AddMember("version", 2, allocator);
+    if (cache.newestTimestamp.count() > 0) {
+        document.AddMember("newestTimestamp", static_cast<int64_t>(cache.newestTimestamp.count()), allocator);
+    }
+    if (!cache.backfillCursor.empty()) {
+        document.AddMember("backfillCursor", rapidjson::Value(cache.backfillCursor.c_str(), allocator), allocator);
+    }
 
     rapidjson::Value items(rapidjson::kArrayType);
-    for (const auto& track : tracks) {
+    for (const auto& track : cache.tracks) {
         if (track.id.empty() || track.name.empty()) {
             continue;
         }
@@ -438,16 +447,12 @@ void saveRecentlyPlayedCache(const std::filesystem::path& path, const std::vecto
     rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
     document.Accept(writer);
 
-    std::ofstream file(path, std::ios::binary | std::ios::trunc);
-    if (!file.is_open()) {
-        AirbudsSearch::Log.warn("Failed to write recently played cache: {}", path.string());
-        return;
-    }
-    file.write(buffer.GetString(), static_cast<std::streamsize>(buffer.GetSize()));
+    // A concurrent refresh of the same history or a failed write keeps the previous cache and its sync state
+    AirbudsSearch::Utils::writeFileAtomically(path, std::string_view(buffer.GetString(), buffer.GetSize()));
 }
 
-void saveRecentlyPlayedCache(const std::vector<airbuds::PlaylistTrack>& tracks) {
-    saveRecentlyPlayedCache(getRecentlyPlayedCachePath(), tracks);
+void saveRecentlyPlayedCache(const RecentlyPlayedCache& cache) {
+    saveRecentlyPlayedCache(getRecentlyPlayedCachePath(), cache);
 }
 
 std::string getOptionalString(const rapidjson::Value& json, const char* key) {
@@ -554,58 +559,40 @@ std::string getHeaderValue(std::string_view headers, std::string_view key) {
     return trim(value);
 }
 
-AccumulatingStringResponse postJsonWithWebUtils(
+AirbudsSearch::Http::Response postJson(
     std::string_view url,
-    const WebUtils::URLOptions::HeaderMap& headers,
+    AirbudsSearch::Http::Headers headers,
     const std::string& body,
-    std::string_view userAgent
+    std::string_view contentType
 ) {
-    WebUtils::URLOptions options(
-        std::string(url),
-        WebUtils::URLOptions::QueryMap{},
-        headers,
-        false,
-        "",
-        std::string(userAgent),
-        10);
-    return WebUtils::Post<AccumulatingStringResponse>(options, AirbudsSearch::Utils::toSpan(body));
-}
+    headers.emplace_back("User-Agent", std::string(AIRBUDS_USER_AGENT));
 
-template <typename ResponseT>
-size_t getResponseByteCount(const ResponseT& response) {
-    if constexpr (requires { response.totalBytes; }) {
-        return response.totalBytes;
-    }
-    if (response.responseData) {
-        return response.responseData->size();
-    }
-    return 0;
+    // Requests go through the shared connection pool, so paging reuses a warm connection instead of doing a new TLS
+    // handshake. Overlapping reloads (for example the same friend's history from two screens) send identical requests,
+    // which also share one transfer.
+    return AirbudsSearch::Http::post(std::string(url), headers, body, std::string(contentType), AirbudsSearch::CancellationToken());
 }
 
-template <typename ResponseT>
-rapidjson::Document parseJsonPayload(const ResponseT& response, std::string_view context) {
-    if (!response.IsSuccessful()) {
-        if (response.responseData) {
-            throw std::runtime_error(std::format("API ERROR: code = {} data = {}", response.httpCode, *response.responseData));
+rapidjson::Document parseJsonPayload(const AirbudsSearch::Http::Response& response, std::string_view context) {
+    if (!response.error.empty()) {
+        throw std::runtime_error(std::format("API ERROR: {}", response.error));
+    }
+    if (!response.isSuccessful()) {
+        if (!response.body.empty()) {
+            throw std::runtime_error(std::format("API ERROR: code = {} data = {}", response.httpCode, response.body));
         }
         throw std::runtime_error(std::format("API ERROR: code = {}", response.httpCode));
     }
-    if (!response.responseData) {
-        throw std::runtime_error(std::format("API ERROR: Request successful but no data! code = {}", response.httpCode));
-    }
 
-    std::string payload = *response.responseData;
+    const std::string& payload = response.body;
     if (payload.empty()) {
-        const std::string contentType = getHeaderValue(response.responseHeaders, "content-type");
-        const std::string contentEncoding = getHeaderValue(response.responseHeaders, "content-encoding");
-        const std::string contentLength = getHeaderValue(response.responseHeaders, "content-length");
-        const size_t byteCount = getResponseByteCount(response);
+        const std::string contentType = getHeaderValue(response.headers, "content-type");
+        const std::string contentEncoding = getHeaderValue(response.headers, "content-encoding");
+        const std::string contentLength = getHeaderValue(response.headers, "content-length");
         AirbudsSearch::Log.error(
-            "Airbuds API empty body (context={}, http={}, curl={}, bytes={}, content-type={}, content-encoding={}, content-length={})",
+            "Airbuds API empty body (context={}, http={}, content-type={}, content-encoding={}, content-length={})",
             context,
             response.httpCode,
-            response.curlStatus,
-            byteCount,
             contentType.empty() ? "unknown" : contentType,
             contentEncoding.empty() ? "unknown" : contentEncoding,
             contentLength.empty() ? "unknown" : contentLength);
@@ -628,8 +615,8 @@ rapidjson::Document parseJsonPayload(const ResponseT& response, std::string_view
         }
     }
 
-    const std::string contentType = getHeaderValue(response.responseHeaders, "content-type");
-    const std::string contentEncoding = getHeaderValue(response.responseHeaders, "content-encoding");
+    const std::string contentType = getHeaderValue(response.headers, "content-type");
+    const std::string contentEncoding = getHeaderValue(response.headers, "content-encoding");
     throw std::runtime_error(std::format(
         "Airbuds API response not JSON (context={}, content-type={}, content-encoding={}).",
         context,
@@ -707,6 +694,7 @@ std::optional<airbuds::Client::AirbudsCredentials> airbuds::Client::getAirbudsCr
         return std::nullopt;
     }
 
+    std::lock_guard lock(credentialsMutex_);
     if (!isAirbudsAccessTokenValid()) {
         refreshAirbudsAccessToken(refreshToken);
     }
@@ -749,12 +737,7 @@ void airbuds::Client::refreshAirbudsAccessToken(const std::string& refreshToken)
     requestJson.Accept(writer);
     const std::string body = buffer.GetString();
 
-    const WebUtils::URLOptions::HeaderMap headers = {
-        {"Content-Type", std::string(AIRBUDS_REFRESH_CONTENT_TYPE)},
-    };
-
-    const AccumulatingStringResponse response =
-        postJsonWithWebUtils(AIRBUDS_REFRESH_ENDPOINT, headers, body, AIRBUDS_USER_AGENT);
+    const AirbudsSearch::Http::Response response = postJson(AIRBUDS_REFRESH_ENDPOINT, {}, body, AIRBUDS_REFRESH_CONTENT_TYPE);
     const rapidjson::Document document = parseJsonPayload(response, "airbuds-refresh");
     const std::string accessToken = getString(document, "accessToken");
     if (accessToken.empty()) {
@@ -778,11 +761,16 @@ void airbuds::Client::refreshAirbudsAccessToken(const std::string& refreshToken)
 }
 
 void airbuds::Client::resetAirbudsCredentials() {
-    airbudsAccessToken_.clear();
-    airbudsUserId_.clear();
-    airbudsAccessTokenExpiry_.reset();
+    {
+        std::lock_guard lock(credentialsMutex_);
+        airbudsAccessToken_.clear();
+        airbudsUserId_.clear();
+        airbudsAccessTokenExpiry_.reset();
+    }
+    std::lock_guard lock(cacheMutex_);
     lastRecentlyPlayedWarning_.clear();
     cachedFriendRecentlyPlayedTracks_.clear();
+    friendRecentlyPlayedRefreshTimes_.clear();
 }
 
 std::vector<Friend> Client::getFriends() {
@@ -861,33 +849,124 @@ std::vector<PlaylistTrack> Client::getRecentlyPlayed() {
 }
 
 std::vector<PlaylistTrack> Client::getRecentlyPlayedCachedOnly() {
-    if (!cachedRecentlyPlayedTracks_.empty()) {
-        return cachedRecentlyPlayedTracks_;
+    {
+        std::lock_guard lock(cacheMutex_);
+        if (!cachedRecentlyPlayedTracks_.empty()) {
+            return cachedRecentlyPlayedTracks_;
+        }
     }
     RecentlyPlayedCache cache = loadRecentlyPlayedCache();
-    cachedRecentlyPlayedTracks_ = cache.tracks;
+    std::lock_guard lock(cacheMutex_);
+    if (cachedRecentlyPlayedTracks_.empty()) {
+        cachedRecentlyPlayedTracks_ = std::move(cache.tracks);
+    }
     return cachedRecentlyPlayedTracks_;
 }
 
 std::vector<PlaylistTrack> Client::getRecentlyPlayedForUser(const std::string& userId) {
-    if (userId.empty()) {
-        return getRecentlyPlayedTracks();
-    }
-    const std::filesystem::path cachePath = getFriendRecentlyPlayedCachePath(userId);
-    return getRecentlyPlayedTracksForUser(userId, &cachedFriendRecentlyPlayedTracks_[userId], cachePath);
+    const std::filesystem::path cachePath = userId.empty() ? getRecentlyPlayedCachePath() : getFriendRecentlyPlayedCachePath(userId);
+    {
+        std::lock_guard lock(cacheMutex_);
+        lastRecentlyPlayedWarning_.clear();
+    }
+    std::string warning;
+    std::vector<PlaylistTrack> tracks = getRecentlyPlayedTracksForUser(userId, cachePath, warning);
+    setCachedRecentlyPlayedTracks(userId, tracks, warning.empty());
+    std::lock_guard lock(cacheMutex_);
+    lastRecentlyPlayedWarning_ = warning;
+    return tracks;
 }
 
 std::vector<PlaylistTrack> Client::getRecentlyPlayedCachedOnlyForUser(const std::string& userId) {
     if (userId.empty()) {
         return getRecentlyPlayedCachedOnly();
     }
-    auto existing = cachedFriendRecentlyPlayedTracks_.find(userId);
-    if (existing != cachedFriendRecentlyPlayedTracks_.end() && !existing->second.empty()) {
-        return existing->second;
+    {
+        std::lock_guard lock(cacheMutex_);
+        auto existing = cachedFriendRecentlyPlayedTracks_.find(userId);
+        if (existing != cachedFriendRecentlyPlayedTracks_.end() && !existing->second.empty()) {
+            return existing->second;
+        }
     }
     RecentlyPlayedCache cache = loadRecentlyPlayedCache(getFriendRecentlyPlayedCachePath(userId));
-    cachedFriendRecentlyPlayedTracks_[userId] = cache.tracks;
-    return cachedFriendRecentlyPlayedTracks_[userId];
+    std::lock_guard lock(cacheMutex_);
+    std::vector<PlaylistTrack>& tracks = cachedFriendRecentlyPlayedTracks_[userId];
+    if (tracks.empty()) {
+        tracks = std::move(cache.tracks);
+    }
+    return tracks;
+}
+
+void Client::setCachedRecentlyPlayedTracks(const std::string& userId, const std::vector<PlaylistTrack>& tracks, const bool isRefreshed) {
+    std::lock_guard lock(cacheMutex_);
+    if (userId.empty()) {
+        cachedRecentlyPlayedTracks_ = tracks;
+        return;
+    }
+    cachedFriendRecentlyPlayedTracks_[userId] = tracks;
+    if (isRefreshed) {
+        friendRecentlyPlayedRefreshTimes_[userId] = std::chrono::steady_clock::now();
+    }
+}
+
+bool Client::isRecentlyPlayedFreshForUser(const std::string& userId) {
+    std::lock_guard lock(cacheMutex_);
+    const auto it = friendRecentlyPlayedRefreshTimes_.find(userId);
+    return it != friendRecentlyPlayedRefreshTimes_.end() && std::chrono::steady_clock::now() - it->second < FRIEND_HISTORY_FRESH_DURATION;
+}
+
+void Client::refreshFriendHistoriesAsync(const std::vector<Friend>& friends) {
+    if (!AirbudsSearch::isFriendHistorySyncEnabled() || friends.empty()) {
+        return;
+    }
+    bool isRefreshing = false;
+    if (!isRefreshingFriendHistories_.compare_exchange_strong(isRefreshing, true)) {
+        return;
+    }
+
+    std::thread([this, friends]() {
+        // Lower the priority so the refresh doesn't compete with the game. The pool threads inherit it.
+        setpriority(PRIO_PROCESS, 0, 10);
+
+        const auto startTime = std::chrono::steady_clock::now();
+        AirbudsSearch::RateLimiter rateLimiter(AirbudsSearch::getFriendHistorySyncRequestsPerMinute());
+        AirbudsSearch::ThreadPool pool(AirbudsSearch::getFriendHistorySyncMaxConnections());
+        std::mutex refreshedTracksMutex;
+        std::vector<PlaylistTrack> refreshedTracks;
+        std::atomic<size_t> refreshedCount = 0;
+        for (const Friend& friendUser : friends) {
+            if (friendUser.id.empty() || isRecentlyPlayedFreshForUser(friendUser.id)) {
+                continue;
+            }
+            pool.submit([&, friendId = friendUser.id]() {
+                try {
+                    std::string warning;
+                    std::vector<PlaylistTrack> tracks = getRecentlyPlayedTracksForUser(friendId, getFriendRecentlyPlayedCachePath(friendId), warning, &rateLimiter);
+                    setCachedRecentlyPlayedTracks(friendId, tracks, warning.empty());
+                    if (!warning.empty()) {
+                        return;
+                    }
+                    ++refreshedCount;
+                    std::lock_guard lock(refreshedTracksMutex);
+                    refreshedTracks.insert(refreshedTracks.end(), std::make_move_iterator(tracks.begin()), std::make_move_iterator(tracks.end()));
+                } catch (const std::exception& exception) {
+                    AirbudsSearch::Log.warn("Friend history refresh failed: friend = {} error = {}", friendId, exception.what());
+                }
+            });
+        }
+        pool.wait();
+
+        // One romanization batch for every refreshed history. The tracks aren't queued for matching, since most of
+        // these histories are never opened.
+        AirbudsSearch::Filter::warmRomanizationCache(refreshedTracks);
+
+        AirbudsSearch::Log.info(
+            "Refreshed friend histories: {}/{} time = {} ms",
+            refreshedCount.load(),
+            friends.size(),
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count());
+        isRefreshingFriendHistories_ = false;
+    }).detach();
 }
 
 std::vector<PlaylistTrack> Client::getPlaylistTracks(const std::string_view playlistId) {
@@ -1021,14 +1100,12 @@ rapidjson::Document Client::apiGetRecentlyPlayed(
 
     const std::string body = buffer.GetString();
 
-    const WebUtils::URLOptions::HeaderMap headers = {
+    const AirbudsSearch::Http::Headers headers = {
         {"Accept", std::string(AIRBUDS_ACCEPT_HEADER)},
         {"Authorization", std::format("Bearer {}", credentials.accessToken)},
-        {"Content-Type", "application/json"},
     };
 
-    const AccumulatingStringResponse response =
-        postJsonWithWebUtils(AIRBUDS_GRAPHQL_ENDPOINT, headers, body, AIRBUDS_USER_AGENT);
+    const AirbudsSearch::Http::Response response = postJson(AIRBUDS_GRAPHQL_ENDPOINT, headers, body, "application/json");
     const rapidjson::Document document = parseJsonPayload(response, "airbuds-graphql");
     if (document.HasMember("errors")) {
         throw std::runtime_error(std::format("Airbuds API error: {}", toString(document["errors"])));
@@ -1064,14 +1141,12 @@ rapidjson::Document Client::apiGetFriends(const AirbudsCredentials& credentials)
 
     const std::string body = buffer.GetString();
 
-    const WebUtils::URLOptions::HeaderMap headers = {
+    const AirbudsSearch::Http::Headers headers = {
         {"Accept", std::string(AIRBUDS_ACCEPT_HEADER)},
         {"Authorization", std::format("Bearer {}", credentials.accessToken)},
-        {"Content-Type", "application/json"},
     };
 
-    const AccumulatingStringResponse response =
-        postJsonWithWebUtils(AIRBUDS_GRAPHQL_ENDPOINT, headers, body, AIRBUDS_USER_AGENT);
+    const AirbudsSearch::Http::Response response = postJson(AIRBUDS_GRAPHQL_ENDPOINT, headers, body, "application/json");
     const rapidjson::Document document = parseJsonPayload(response, "airbuds-graphql-friends");
     if (document.HasMember("errors")) {
         throw std::runtime_error(std::format("Airbuds API error: {}", toString(document["errors"])));
@@ -1083,14 +1158,15 @@ rapidjson::Document Client::apiGetFriends(const AirbudsCredentials& credentials)
 }
 
 std::vector<PlaylistTrack> Client::getRecentlyPlayedTracks() {
-    return getRecentlyPlayedTracksForUser("", &cachedRecentlyPlayedTracks_, getRecentlyPlayedCachePath());
+    return getRecentlyPlayedForUser("");
 }
 
 std::vector<PlaylistTrack> Client::getRecentlyPlayedTracksForUser(
     const std::string& userId,
-    std::vector<PlaylistTrack>* cachedTracks,
-    const std::filesystem::path& cachePath) {
-    lastRecentlyPlayedWarning_.clear();
+    const std::filesystem::path& cachePath,
+    std::string& warning,
+    AirbudsSearch::RateLimiter* const backgroundRateLimiter) {
+    warning.clear();
     RecentlyPlayedCache cache = loadRecentlyPlayedCache(cachePath);
     std::unordered_set<std::string> cachedKeys;
     if (!cache.tracks.empty()) {
@@ -1103,10 +1179,7 @@ std::vector<PlaylistTrack> Client::getRecentlyPlayedTracksForUser(
     const auto credentials = getAirbudsCredentials();
     if (!credentials) {
         if (!cache.tracks.empty()) {
-            lastRecentlyPlayedWarning_ = "Airbuds refresh token missing; showing cached history.";
-            if (cachedTracks) {
-                *cachedTracks = cache.tracks;
-            }
+            warning = "Airbuds refresh token missing; showing cached history.";
             return cache.tracks;
         }
         throw std::runtime_error("Airbuds refresh token is missing.");
@@ -1120,108 +1193,141 @@ std::vector<PlaylistTrack> Client::getRecentlyPlayedTracksForUser(
         throw std::runtime_error("Airbuds API userId is missing.");
     }
 
-    std::vector<PlaylistTrack> newTracks;
-    std::unordered_set<std::string> newKeys;
-    newKeys.reserve(cache.tracks.size() + 64);
-    std::optional<std::string> cursor;
-    bool hasNextPage = true;
-    std::string lastCursor;
-    bool reachedCachedBoundary = false;
+    struct RecentlyPlayedPage {
+        std::vector<PlaylistTrack> tracks;
+        std::optional<std::string> nextCursor;
+    };
+    const auto fetchPage = [&](const std::optional<std::string>& cursor) {
+        if (backgroundRateLimiter) {
+            backgroundRateLimiter->acquire();
+        }
+        const rapidjson::Document document = apiGetRecentlyPlayed(*credentials, targetUserId, cursor, AIRBUDS_PAGE_LIMIT);
+        if (!document.HasMember("data") || !document["data"].IsObject()) {
+            throw std::runtime_error("Airbuds API response missing data.");
+        }
+        const auto& userJson = document["data"]["userWithID"];
+        if (!userJson.IsObject() || !userJson.HasMember("recentlyPlayed")) {
+            throw std::runtime_error("Airbuds API response missing recentlyPlayed.");
+        }
+        const auto& recentlyPlayed = userJson["recentlyPlayed"];
+        if (!recentlyPlayed.IsObject() || !recentlyPlayed.HasMember("items") || !recentlyPlayed["items"].IsArray()) {
+            throw std::runtime_error("Airbuds API response missing items.");
+        }
 
-    try {
-        while (hasNextPage) {
-            const rapidjson::Document document = apiGetRecentlyPlayed(*credentials, targetUserId, cursor, AIRBUDS_PAGE_LIMIT);
-            if (!document.HasMember("data") || !document["data"].IsObject()) {
-                throw std::runtime_error("Airbuds API response missing data.");
+        RecentlyPlayedPage page;
+        const auto& items = recentlyPlayed["items"].GetArray();
+        page.tracks.reserve(items.Size());
+        for (const auto& item : items) {
+            if (!item.IsObject() || !item.HasMember("object")) {
+                continue;
             }
-            const auto& userJson = document["data"]["userWithID"];
-            if (!userJson.IsObject() || !userJson.HasMember("recentlyPlayed")) {
-                throw std::runtime_error("Airbuds API response missing recentlyPlayed.");
+            const auto& object = item["object"];
+            if (!object.IsObject() || !object.HasMember("openable")) {
+                continue;
             }
-            const auto& recentlyPlayed = userJson["recentlyPlayed"];
-            if (!recentlyPlayed.IsObject() || !recentlyPlayed.HasMember("items") || !recentlyPlayed["items"].IsArray()) {
-                throw std::runtime_error("Airbuds API response missing items.");
+            const auto& openable = object["openable"];
+            if (!openable.IsObject()) {
+                continue;
             }
 
-            const auto& items = recentlyPlayed["items"].GetArray();
-            for (const auto& item : items) {
-                if (!item.IsObject() || !item.HasMember("object")) {
-                    continue;
-                }
-                const auto& object = item["object"];
-                if (!object.IsObject() || !object.HasMember("openable")) {
-                    continue;
-                }
-                const auto& openable = object["openable"];
-                if (!openable.IsObject()) {
-                    continue;
-                }
+            PlaylistTrack track;
+            track.id = getOptionalString(openable, "id");
+            track.name = getOptionalString(openable, "name");
+            track.album.url = getOptionalString(openable, "artworkURL");
 
-                PlaylistTrack track;
-                track.id = getOptionalString(openable, "id");
-                track.name = getOptionalString(openable, "name");
-                track.album.url = getOptionalString(openable, "artworkURL");
+            const std::string artistName = getOptionalString(openable, "artistName");
+            track.artists = parseArtistsFromName(artistName);
 
-                const std::string artistName = getOptionalString(openable, "artistName");
-                track.artists = parseArtistsFromName(artistName);
+            track.dateAdded = getOptionalString(item, "playedAtMax");
+            if (!track.dateAdded.empty()) {
+                track.dateAdded_ = parseIso8601ToMillis(track.dateAdded);
+            } else {
+                track.dateAdded_ = std::chrono::milliseconds(0);
+            }
 
-                track.dateAdded = getOptionalString(item, "playedAtMax");
-                if (!track.dateAdded.empty()) {
-                    track.dateAdded_ = parseIso8601ToMillis(track.dateAdded);
-                } else {
-                    track.dateAdded_ = std::chrono::milliseconds(0);
-                }
+            if (track.id.empty() || track.name.empty()) {
+                continue;
+            }
+            page.tracks.push_back(std::move(track));
+        }
 
-                if (track.id.empty() || track.name.empty()) {
-                    continue;
-                }
+        if (recentlyPlayed.HasMember("pageInfo") && recentlyPlayed["pageInfo"].IsObject()) {
+            const auto& pageInfo = recentlyPlayed["pageInfo"];
+            const bool hasNextPage = pageInfo.HasMember("hasNextPage") && pageInfo["hasNextPage"].IsBool() && pageInfo["hasNextPage"].GetBool();
+            std::string nextCursor = getOptionalString(pageInfo, "endCursor");
+            if (hasNextPage && !nextCursor.empty() && nextCursor != cursor) {
+                page.nextCursor = std::move(nextCursor);
+            }
+        }
+        return page;
+    };
 
-                if (cache.oldestTimestamp.count() > 0
-                    && track.dateAdded_.count() > 0
-                    && track.dateAdded_ <= cache.oldestTimestamp) {
-                    reachedCachedBoundary = true;
-                    break;
-                }
+    std::vector<PlaylistTrack> newTracks;
+    std::unordered_set<std::string> newKeys;
+    newKeys.reserve(cache.tracks.size() + 64);
+    const auto addTrack = [&](const PlaylistTrack& track) {
+        const std::string key = makeRecentlyPlayedKey(track);
+        if (cachedKeys.contains(key) || !newKeys.insert(key).second) {
+            return;
+        }
+        newTracks.push_back(track);
+    };
 
-                const std::string key = makeRecentlyPlayedKey(track);
-                if (!cachedKeys.empty() && cachedKeys.contains(key)) {
-                    continue;
-                }
-                if (!newKeys.insert(key).second) {
-                    continue;
+    // Without a watermark this is the first sync, which walks the whole history. It remembers the cursor of the next
+    // page as it goes, so an interruption keeps the pages fetched so far and the next refresh continues from there.
+    const bool isInitialSync = cache.newestTimestamp.count() == 0;
+    std::string backfillCursor = cache.backfillCursor;
+
+    try {
+        // Page from the newest play until the watermark is crossed, which is a single page for a routine refresh
+        std::optional<std::string> cursor;
+        while (true) {
+            const RecentlyPlayedPage page = fetchPage(cursor);
+            bool isWatermarkReached = false;
+            for (const auto& track : page.tracks) {
+                if (!isInitialSync && track.dateAdded_.count() > 0 && track.dateAdded_ <= cache.newestTimestamp) {
+                    isWatermarkReached = true;
+                    break;
                 }
-                newTracks.push_back(track);
+                addTrack(track);
             }
-
-            if (reachedCachedBoundary) {
+            if (isWatermarkReached || !page.nextCursor) {
                 break;
             }
-
-            hasNextPage = false;
-            if (recentlyPlayed.HasMember("pageInfo") && recentlyPlayed["pageInfo"].IsObject()) {
-                const auto& pageInfo = recentlyPlayed["pageInfo"];
-                if (pageInfo.HasMember("hasNextPage") && pageInfo["hasNextPage"].IsBool()) {
-                    hasNextPage = pageInfo["hasNextPage"].GetBool();
-                }
-                const std::string nextCursor = getOptionalString(pageInfo, "endCursor");
-                if (nextCursor.empty() || nextCursor == lastCursor) {
-                    hasNextPage = false;
-                } else {
-                    cursor = nextCursor;
-                    lastCursor = nextCursor;
-                }
+            cursor = page.nextCursor;
+            if (isInitialSync) {
+                backfillCursor = *cursor;
             }
         }
+        if (isInitialSync) {
+            backfillCursor.clear();
+        }
     } catch (const std::exception& exception) {
-        if (!cache.tracks.empty()) {
+        if (isInitialSync && !newTracks.empty()) {
+            AirbudsSearch::Log.warn("Recently played backfill interrupted: {}", exception.what());
+            warning = "Refresh interrupted; showing partial history.";
+        } else if (!cache.tracks.empty()) {
             AirbudsSearch::Log.warn("Recently played refresh failed: {}", exception.what());
-            lastRecentlyPlayedWarning_ = "Refresh failed; showing cached history.";
-            if (cachedTracks) {
-                *cachedTracks = cache.tracks;
-            }
+            warning = "Refresh failed; showing cached history.";
             return cache.tracks;
+        } else {
+            throw;
+        }
+    }
+
+    // Continue an interrupted backfill below the cached history. A failure here only delays it to the next refresh.
+    if (!isInitialSync && !backfillCursor.empty()) {
+        try {
+            while (!backfillCursor.empty()) {
+                const RecentlyPlayedPage page = fetchPage(backfillCursor);
+                for (const auto& track : page.tracks) {
+                    addTrack(track);
+                }
+                backfillCursor = page.nextCursor.value_or("");
+            }
+        } catch (const std::exception& exception) {
+            AirbudsSearch::Log.warn("Recently played backfill failed: {}", exception.what());
         }
-        throw;
     }
 
     std::vector<PlaylistTrack> merged;
@@ -1256,14 +1362,30 @@ std::vector<PlaylistTrack> Client::getRecentlyPlayedTracksForUser(
         });
     }
 
-    saveRecentlyPlayedCache(cachePath, merged);
-    if (cachedTracks) {
-        *cachedTracks = merged;
+    // Nothing to write when the refresh found no new plays, which is the common case
+    if (!newTracks.empty() || backfillCursor != cache.backfillCursor) {
+        std::chrono::milliseconds newestTimestamp = cache.newestTimestamp;
+        for (const auto& track : newTracks) {
+            newestTimestamp = std::max(newestTimestamp, track.dateAdded_);
+        }
+        saveRecentlyPlayedCache(cachePath, RecentlyPlayedCache{merged, newestTimestamp, backfillCursor});
+    }
+    if (backgroundRateLimiter) {
+        return merged;
     }
+
+    // Match the new tracks in the background so selecting them later shows results instantly
+    AirbudsSearch::MatchIndex::getInstance().indexTracksAsync(newTracks);
+
+    // Romanize the whole history in one batch now, instead of one title at a time during searches. Titles romanized
+    // in earlier launches are loaded from disk and skipped.
+    AirbudsSearch::Filter::warmRomanizationCache(merged);
+
     return merged;
 }
 
 std::string Client::getLastRecentlyPlayedWarning() const {
+    std::lock_guard lock(cacheMutex_);
     return lastRecentlyPlayedWarning_;
 }
 
@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <cctype>
+#include <thread>
+
+#include "beatsaverplusplus/shared/BeatSaver.hpp"
+#include "song-details/shared/SongDetails.hpp"
+#include "web-utils/shared/WebUtils.hpp" // For rapidjson
+
+#include "BeatSaverSearch.hpp"
+#include "HttpClient.hpp"
+#include "Log.hpp"
+#include "SearchResponseCache.hpp"
+#include "Utils.hpp"
+
+namespace AirbudsSearch::BeatSaverSearch {
+
+std::string urlEncodeQuery(std::string_view text) {
+    static constexpr char kHex[] = "0123456789ABCDEF";
+    std::string output;
+    output.reserve(text.size() * 3);
+    for (unsigned char c : text) {
+        if ((c >= 'A' && c <= 'Z')
+            || (c >= 'a' && c <= 'z')
+            || (c >= '0' && c <= '9')
+            || c == '-' || c == '_' || c == '.' || c == '~') {
+            output.push_back(static_cast<char>(c));
+            continue;
+        }
+        output.push_back('%');
+        output.push_back(kHex[(c >> 4) & 0xF]);
+        output.push_back(kHex[c & 0xF]);
+    }
+    return output;
+}
+
+// Maps a BeatSaver difficulty name to its bit in SearchCandidate::difficultyMask, or 0 if it is unknown
+static uint8_t getDifficultyBit(const std::string_view name) {
+    const auto equalsIgnoreCase = [name](const std::string_view expected) {
+        return std::ranges::equal(name, expected, [](const unsigned char a, const unsigned char b) {
+            return std::tolower(a) == b;
+        });
+    };
+    const auto bit = [](const SongDetailsCache::MapDifficulty difficulty) {
+        return static_cast<uint8_t>(1u << static_cast<uint8_t>(difficulty));
+    };
+    if (equalsIgnoreCase("easy")) return bit(SongDetailsCache::MapDifficulty::Easy);
+    if (equalsIgnoreCase("normal")) return bit(SongDetailsCache::MapDifficulty::Normal);
+    if (equalsIgnoreCase("hard")) return bit(SongDetailsCache::MapDifficulty::Hard);
+    if (equalsIgnoreCase("expert")) return bit(SongDetailsCache::MapDifficulty::Expert);
+    if (equalsIgnoreCase("expertplus") || equalsIgnoreCase("expert+")) return bit(SongDetailsCache::MapDifficulty::ExpertPlus);
+    return 0;
+}
+
+/**
+ * SAX handler that copies the fields of SearchCandidate out of a search page as the parser reads them. Everything
+ * else (uploader, tags, older versions, difficulty details, ...) is skipped without being stored.
+ */
+class SearchPageHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, SearchPageHandler> {
+
+    public:
+    explicit SearchPageHandler(std::vector<SearchCandidate>& candidates) : candidates_(candidates) {}
+
+    bool hasDocs() const {
+        return hasDocs_;
+    }
+
+    bool StartObject() {
+        return enter(false);
+    }
+
+    bool EndObject(rapidjson::SizeType) {
+        scopes_.pop_back();
+        return true;
+    }
+
+    bool StartArray() {
+        return enter(true);
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+        scopes_.pop_back();
+        return true;
+    }
+
+    bool Key(const char* text, const rapidjson::SizeType length, bool) {
+        key_.assign(text, length);
+        return true;
+    }
+
+    bool String(const char* text, const rapidjson::SizeType length, bool) {
+        if (scopes_.empty()) {
+            return true;
+        }
+        const std::string_view value(text, length);
+        switch (scopes_.back()) {
+            case Scope::Doc:
+                if (key_ == "id") {
+                    candidates_.back().id = value;
+                } else if (key_ == "name") {
+                    candidates_.back().name = value;
+                }
+                break;
+            case Scope::Metadata:
+                if (key_ == "songName") {
+                    candidates_.back().songName = value;
+                } else if (key_ == "songAuthorName") {
+                    candidates_.back().songAuthorName = value;
+                } else if (key_ == "levelAuthorName") {
+                    candidates_.back().levelAuthorName = value;
+                }
+                break;
+            case Scope::LatestVersion:
+                if (key_ == "hash") {
+                    candidates_.back().hash = value;
+                } else if (key_ == "key") {
+                    candidates_.back().key = std::string(value);
+                }
+                break;
+            case Scope::Diff:
+                if (key_ == "difficulty") {
+                    candidates_.back().difficultyMask |= getDifficultyBit(value);
+                }
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    bool Int(const int value) {
+        return number(value);
+    }
+
+    bool Uint(const unsigned value) {
+        return number(value);
+    }
+
+    bool Int64(const int64_t value) {
+        return number(static_cast<double>(value));
+    }
+
+    bool Uint64(const uint64_t value) {
+        return number(static_cast<double>(value));
+    }
+
+    bool Double(const double value) {
+        return number(value);
+    }
+
+    private:
+    enum class Scope {
+        Root,
+        Docs,
+        Doc,
+        Metadata,
+        Stats,
+        Versions,
+        LatestVersion,
+        Diffs,
+        Diff,
+        Ignored,
+    };
+
+    std::vector<SearchCandidate>& candidates_;
+    std::vector<Scope> scopes_;
+
+    // Last key read. Only meaningful for values directly inside an object. Copied, because the parser reuses the
+    // buffer it points to.
+    std::string key_;
+
+    // Number of versions seen in the current doc. The first one is the latest.
+    size_t versionCount_ = 0;
+    bool hasDocs_ = false;
+
+    bool enter(const bool isArray) {
+        if (scopes_.empty()) {
+            scopes_.push_back(isArray ? Scope::Ignored : Scope::Root);
+            return true;
+        }
+        Scope scope = Scope::Ignored;
+        switch (scopes_.back()) {
+            case Scope::Root:
+                if (isArray && key_ == "docs") {
+                    scope = Scope::Docs;
+                    hasDocs_ = true;
+                }
+                break;
+            case Scope::Docs:
+                if (!isArray) {
+                    scope = Scope::Doc;
+                    candidates_.emplace_back();
+                    versionCount_ = 0;
+                }
+                break;
+            case Scope::Doc:
+                if (!isArray && key_ == "metadata") {
+                    scope = Scope::Metadata;
+                } else if (!isArray && key_ == "stats") {
+                    scope = Scope::Stats;
+                } else if (isArray && key_ == "versions") {
+                    scope = Scope::Versions;
+                }
+                break;
+            case Scope::Versions:
+                if (!isArray && versionCount_++ == 0) {
+                    scope = Scope::LatestVersion;
+                }
+                break;
+            case Scope::LatestVersion:
+                if (isArray && key_ == "diffs") {
+                    scope = Scope::Diffs;
+                }
+                break;
+            case Scope::Diffs:
+                if (!isArray) {
+                    scope = Scope::Diff;
+                }
+                break;
+            default:
+                break;
+        }
+        scopes_.push_back(scope);
+        return true;
+    }
+
+    bool number(const double value) {
+        if (!scopes_.empty() && scopes_.back() == Scope::Stats && key_ == "score") {
+            candidates_.back().score = static_cast<float>(value);
+        }
+        return true;
+    }
+};
+
+static bool parseSearchPage(const std::string& body, SearchPageResult& result) {
+    std::vector<SearchCandidate> candidates;
+    // A full page
+    candidates.reserve(20);
+    SearchPageHandler handler(candidates);
+    rapidjson::Reader reader;
+    rapidjson::StringStream stream(body.c_str());
+    if (reader.Parse(stream, handler).IsError() || !handler.hasDocs()) {
+        return false;
+    }
+    result.successful = true;
+    result.docs = std::move(candidates);
+    return true;
+}
+
+static std::string getCacheKey(const std::string& query, const int page) {
+    // BeatSaver search is case-insensitive
+    return std::format("search/text/{}?q={}", page, urlEncodeQuery(Utils::toLowerCase(query)));
+}
+
+static void revalidateInBackground(const std::string& cacheKey, const std::string& url) {
+    if (!SearchResponseCache::getInstance().beginRevalidation(cacheKey)) {
+        return;
+    }
+    std::thread([cacheKey, url]() {
+        // Not tied to the search that triggered it, so it is never cancelled
+        const Http::Response response = Http::get(url, CancellationToken());
+        SearchPageResult result;
+        if (response.isSuccessful() && parseSearchPage(response.body, result)) {
+            SearchResponseCache::getInstance().put(cacheKey, response.body);
+        }
+        AirbudsSearch::Log.info("BeatSaver search cache refreshed: key={} http={} error=\"{}\"", cacheKey, response.httpCode, response.error);
+        SearchResponseCache::getInstance().endRevalidation(cacheKey);
+    }).detach();
+}
+
+SearchPageResult fetchSearchPage(const std::string& query, const int page, const CancellationToken& cancellationToken) {
+    SearchPageResult result;
+    if (cancellationToken.isCancelled()) {
+        result.cancelled = true;
+        return result;
+    }
+
+    const std::string encodedQuery = urlEncodeQuery(query);
+    const std::string url = std::format(BEATSAVER_API_URL "/search/text/{}?q={}&sortOrder=Relevance", page, encodedQuery);
+    const std::string cacheKey = getCacheKey(query, page);
+
+    // Use the cached response if we have one. Stale responses are still used, but refreshed for next time.
+    if (const std::optional<SearchResponseCache::Entry> entry = SearchResponseCache::getInstance().get(cacheKey)) {
+        if (parseSearchPage(entry->body, result)) {
+            result.fromCache = true;
+            AirbudsSearch::Log.info("BeatSaver search cache hit: query=\"{}\" stale={}", query, entry->isStale);
+            if (entry->isStale) {
+                revalidateInBackground(cacheKey, url);
+            }
+            return result;
+        }
+        AirbudsSearch::Log.warn("BeatSaver search cache entry could not be parsed: key={}", cacheKey);
+    }
+
+    AirbudsSearch::Log.info("BeatSaver request: Search url={} query=\"{}\" encoded=\"{}\"", url, query, encodedQuery);
+    const Http::Response response = Http::get(url, cancellationToken);
+    result.httpCode = response.httpCode;
+    result.cancelled = response.cancelled;
+    if (response.cancelled) {
+        AirbudsSearch::Log.info("BeatSaver request cancelled: Search query=\"{}\"", query);
+        return result;
+    }
+
+    const bool parsed = response.isSuccessful() && parseSearchPage(response.body, result);
+    AirbudsSearch::Log.info(
+        "BeatSaver response: Search query=\"{}\" http={} error=\"{}\" bytes={} parsed={}",
+        query,
+        response.httpCode,
+        response.error,
+        response.body.size(),
+        parsed);
+    if (parsed) {
+        SearchResponseCache::getInstance().put(cacheKey, response.body);
+    }
+    return result;
+}
+
+}// namespace AirbudsSearch::BeatSaverSearch
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "Configuration.hpp"
 
 namespace AirbudsSearch {
@@ -56,4 +58,117 @@ void clearAirbudsRefreshToken() {
     setAirbudsRefreshToken("");
 }
 
+// Returns the member of the "airbuds" config object, or nullptr if it is missing
+static const rapidjson::Value* getAirbudsConfigMember(const char* name) {
+    const auto& config = getConfig().config;
+    if (!config.HasMember("airbuds") || !config["airbuds"].IsObject()) {
+        return nullptr;
+    }
+    const auto& airbuds = config["airbuds"];
+    if (!airbuds.HasMember(name)) {
+        return nullptr;
+    }
+    return &airbuds[name];
+}
+
+bool isFriendHistorySyncEnabled() {
+    const rapidjson::Value* value = getAirbudsConfigMember("friendHistorySync");
+    if (!value || !value->IsBool()) {
+        return false;
+    }
+    return value->GetBool();
+}
+
+size_t getFriendHistorySyncMaxConnections() {
+    static constexpr size_t DEFAULT_MAX_CONNECTIONS = 2;
+    const rapidjson::Value* value = getAirbudsConfigMember("friendHistoryMaxConnections");
+    if (!value || !value->IsInt()) {
+        return DEFAULT_MAX_CONNECTIONS;
+    }
+    return static_cast<size_t>(std::clamp(value->GetInt(), 1, 4));
+}
+
+size_t getFriendHistorySyncRequestsPerMinute() {
+    static constexpr size_t DEFAULT_REQUESTS_PER_MINUTE = 30;
+    const rapidjson::Value* value = getAirbudsConfigMember("friendHistoryRequestsPerMinute");
+    if (!value || !value->IsInt()) {
+        return DEFAULT_REQUESTS_PER_MINUTE;
+    }
+    return static_cast<size_t>(std::clamp(value->GetInt(), 1, 120));
+}
+
+// Returns the member of the "search" config object, or nullptr if it is missing
+static const rapidjson::Value* getSearchConfigMember(const char* name) {
+    const auto& config = getConfig().config;
+    if (!config.HasMember("search") || !config["search"].IsObject()) {
+        return nullptr;
+    }
+    const auto& search = config["search"];
+    if (!search.HasMember(name)) {
+        return nullptr;
+    }
+    return &search[name];
+}
+
+size_t getSearchMaxConcurrentRequests() {
+    static constexpr size_t DEFAULT_MAX_CONCURRENT_REQUESTS = 4;
+    const rapidjson::Value* value = getSearchConfigMember("maxConcurrentRequests");
+    if (!value || !value->IsInt()) {
+        return DEFAULT_MAX_CONCURRENT_REQUESTS;
+    }
+    return static_cast<size_t>(std::clamp(value->GetInt(), 1, 8));
+}
+
+bool isProgressiveSearchEnabled() {
+    const rapidjson::Value* value = getSearchConfigMember("progressiveResults");
+    if (!value || !value->IsBool()) {
+        return true;
+    }
+    return value->GetBool();
+}
+
+bool isOnlineSearchEnabled() {
+    const rapidjson::Value* value = getSearchConfigMember("onlineSearch");
+    if (!value || !value->IsBool()) {
+        return true;
+    }
+    return value->GetBool();
+}
+
+std::chrono::hours getSearchCacheTtl() {
+    static constexpr int DEFAULT_TTL_HOURS = 24;
+    const rapidjson::Value* value = getSearchConfigMember("cacheTtlHours");
+    if (!value || !value->IsInt()) {
+        return std::chrono::hours(DEFAULT_TTL_HOURS);
+    }
+    return std::chrono::hours(std::max(value->GetInt(), 0));
+}
+
+uintmax_t getSearchCacheMaxSizeBytes() {
+    static constexpr int DEFAULT_MAX_SIZE_MB = 32;
+    const rapidjson::Value* value = getSearchConfigMember("cacheMaxSizeMB");
+    if (!value || !value->IsInt()) {
+        return static_cast<uintmax_t>(DEFAULT_MAX_SIZE_MB) * 1024 * 1024;
+    }
+    return static_cast<uintmax_t>(std::max(value->GetInt(), 0)) * 1024 * 1024;
+}
+
+size_t getSearchPrefetchCount() {
+    static constexpr size_t DEFAULT_PREFETCH_COUNT = 3;
+    const rapidjson::Value* value = getSearchConfigMember("prefetchCount");
+    if (!value || !value->IsInt()) {
+        return DEFAULT_PREFETCH_COUNT;
+    }
+    return static_cast<size_t>(std::clamp(value->GetInt(), 0, 10));
+}
+
+std::chrono::hours getMatchIndexTtl() {
+    static constexpr int DEFAULT_TTL_HOURS = 24 * 7;
+    const rapidjson::Value* value = getSearchConfigMember("matchIndexTtlHours");
+    if (!value || !value->IsInt()) {
+        return std::chrono::hours(DEFAULT_TTL_HOURS);
+    }
+    return std::chrono::hours(std::max(value->GetInt(), 0));
+}
+
 }
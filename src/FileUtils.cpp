@@ -0,0 +1,37 @@
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "FileUtils.hpp"
+#include "Log.hpp"
+
+namespace AirbudsSearch::Utils {
+
+bool writeFileAtomically(const std::filesystem::path& path, const std::initializer_list<std::string_view> parts) {
+    // One temporary file per thread, so concurrent writers of the same path don't write into each other's file. Not
+    // std::format, which the desktop build of the search core can't rely on.
+    const std::filesystem::path temporaryPath = path.string() + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    bool isWritten = false;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (file.is_open()) {
+            for (const std::string_view part : parts) {
+                file.write(part.data(), static_cast<std::streamsize>(part.size()));
+            }
+            file.close();
+            isWritten = file.good();
+        }
+    }
+    std::error_code errorCode;
+    if (isWritten) {
+        std::filesystem::rename(temporaryPath, path, errorCode);
+    }
+    if (!isWritten || errorCode) {
+        AirbudsSearch::Log.warn("Failed to write {}: {}", path.string(), isWritten ? errorCode.message() : "write failed");
+        std::filesystem::remove(temporaryPath, errorCode);
+        return false;
+    }
+    return true;
+}
+
+}// namespace AirbudsSearch::Utils
@@ -0,0 +1,1547 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <dlfcn.h>
+#include <sys/resource.h>
+
+#ifdef QUEST
+#include "scotland2/shared/modloader.h"
+
+#include "Configuration.hpp"
+#endif
+
+#include "AhoCorasick.hpp"
+#include "Filter.hpp"
+#include "JapaneseConverter.hpp"
+#include "Log.hpp"
+#include "Normalization.hpp"
+#include "RomanizationCache.hpp"
+#include "Utf8.hpp"
+
+namespace AirbudsSearch::Filter {
+
+static bool isHiragana(uint32_t codepoint);
+static bool isKatakana(uint32_t codepoint);
+static bool isKanji(uint32_t codepoint);
+static bool isJapaneseCodepoint(uint32_t codepoint);
+static std::vector<uint32_t> decodeUtf8(const std::string& text, bool& hasKana, bool& hasKanji);
+
+// Letters and digits, and Japanese characters. Runs of Japanese characters are kept together as a single word.
+static bool isWordCodepoint(const uint32_t codepoint) {
+    if (codepoint <= 0x7F) {
+        return std::isalnum(static_cast<unsigned char>(codepoint)) != 0;
+    }
+    return isHiragana(codepoint)
+        || isKatakana(codepoint)
+        || isKanji(codepoint)
+        || codepoint == 0x30FC
+        || codepoint == 0x3005
+        // Latin letters with diacritics, IPA letters, Greek, Cyrillic and Armenian
+        || (codepoint >= 0x00C0 && codepoint <= 0x02AF && codepoint != 0x00D7 && codepoint != 0x00F7)
+        || (codepoint >= 0x1E00 && codepoint <= 0x1EFF)
+        || (codepoint >= 0x0386 && codepoint <= 0x03FF && codepoint != 0x0387)
+        || (codepoint >= 0x0400 && codepoint <= 0x052F && (codepoint <= 0x0481 || codepoint >= 0x048A))
+        || (codepoint >= 0x0531 && codepoint <= 0x0586);
+}
+
+static void appendWords(const std::string_view text, WordList& words) {
+    // Words are never longer than the text they come from, so this is the only time the buffer grows
+    words.reserve(text.size());
+    for (size_t i = 0; i < text.size();) {
+        // Most titles are pure ASCII. ASCII runs are split in place, only multibyte characters are decoded.
+        const size_t asciiEnd = i + Utf8::countAsciiPrefix(text.substr(i));
+        for (; i < asciiEnd; ++i) {
+            const unsigned char c = static_cast<unsigned char>(text[i]);
+            if (std::isalnum(c)) {
+                words.append(static_cast<char>(std::tolower(c)));
+            } else {
+                words.endWord();
+            }
+        }
+        if (i == text.size()) {
+            break;
+        }
+
+        uint32_t codepoint = 0;
+        const size_t length = Utf8::decodeCodepoint(text, i, codepoint);
+        if (length == 0) {
+            ++i;
+            continue;
+        }
+        i += length;
+        if (!isWordCodepoint(codepoint)) {
+            words.endWord();
+            continue;
+        }
+        if (codepoint <= 0x7F) {
+            words.append(static_cast<char>(std::tolower(static_cast<unsigned char>(codepoint))));
+            continue;
+        }
+        std::array<char, 4> encoded{};
+        words.append(std::string_view(encoded.data(), Utf8::encodeCodepoint(codepoint, encoded)));
+    }
+    words.endWord();
+}
+
+/**
+ * Calls the callback with every pair of adjacent Japanese characters in the words of the text, so titles that share
+ * part of a Japanese run still have words in common. A word that is exactly two Japanese characters has no bigram,
+ * since it would be the same as the word itself.
+ */
+template<typename Callback>
+static void forEachCjkBigram(const std::string_view text, Callback&& callback) {
+    std::array<char, 8> bigram{};
+    // Length of the previous character in bigram, or 0 if it wasn't Japanese
+    size_t previousLength = 0;
+    size_t wordCodepointCount = 0;
+    // The first bigram of a word is held back until the word turns out to be longer than it
+    bool isBigramHeld = false;
+    std::array<char, 8> heldBigram{};
+    size_t heldBigramLength = 0;
+
+    for (size_t i = 0; i < text.size();) {
+        uint32_t codepoint = 0;
+        const size_t length = Utf8::decodeCodepoint(text, i, codepoint);
+        if (length == 0) {
+            ++i;
+            previousLength = 0;
+            continue;
+        }
+        i += length;
+        if (!isWordCodepoint(codepoint)) {
+            previousLength = 0;
+            wordCodepointCount = 0;
+            isBigramHeld = false;
+            continue;
+        }
+
+        ++wordCodepointCount;
+        if (wordCodepointCount == 3 && isBigramHeld) {
+            callback(std::string_view(heldBigram.data(), heldBigramLength));
+            isBigramHeld = false;
+        }
+        if (!isJapaneseCodepoint(codepoint)) {
+            previousLength = 0;
+            continue;
+        }
+
+        std::array<char, 4> encoded{};
+        const size_t encodedLength = Utf8::encodeCodepoint(codepoint, encoded);
+        if (previousLength > 0) {
+            std::copy_n(encoded.begin(), encodedLength, bigram.begin() + previousLength);
+            const size_t bigramLength = previousLength + encodedLength;
+            if (wordCodepointCount == 2) {
+                heldBigram = bigram;
+                heldBigramLength = bigramLength;
+                isBigramHeld = true;
+            } else {
+                callback(std::string_view(bigram.data(), bigramLength));
+            }
+        }
+        std::copy_n(encoded.begin(), encodedLength, bigram.begin());
+        previousLength = encodedLength;
+    }
+}
+
+// Words first, then the bigrams of Japanese runs
+static void appendWordsAndBigrams(const std::string_view text, WordList& words) {
+    // Each character is in at most two bigrams
+    words.reserve(text.size() * 3);
+    appendWords(text, words);
+    forEachCjkBigram(text, [&words](const std::string_view bigram) {
+        words.append(bigram);
+        words.endWord();
+    });
+}
+
+void splitWords(const std::string_view text, WordList& words) {
+    // ASCII text has no Japanese, so no bigrams either
+    if (Utf8::isAscii(text)) {
+        appendWords(text, words);
+        return;
+    }
+    const Normalization::FoldedText foldedText(text);
+    appendWordsAndBigrams(foldedText.view(), words);
+}
+
+std::vector<std::string> getWords(const std::string& text) {
+    WordList wordList;
+    appendWords(text, wordList);
+    std::vector<std::string> words;
+    words.reserve(wordList.size());
+    for (size_t i = 0; i < wordList.size(); ++i) {
+        words.emplace_back(wordList[i]);
+    }
+    return words;
+}
+
+// 64-bit FNV-1a, folding ASCII to lowercase like appendWords() does
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t hashLowercaseByte(const uint64_t hash, const unsigned char c) {
+    return (hash ^ static_cast<unsigned char>(std::tolower(c))) * FNV_PRIME;
+}
+
+static TokenizedText tokenizeFolded(const std::string_view text) {
+    std::array<TokenizedText::Token, TokenizedText::MAX_TOKENS> tokens;
+    size_t tokenCount = 0;
+    uint64_t textHash = FNV_OFFSET_BASIS;
+    for (const char c : text) {
+        textHash = hashLowercaseByte(textHash, static_cast<unsigned char>(c));
+    }
+
+    TokenizedText::Token current{FNV_OFFSET_BASIS, 0};
+    auto flush = [&]() {
+        if (current.length > 0 && tokenCount < tokens.size()) {
+            tokens[tokenCount++] = current;
+        }
+        current = TokenizedText::Token{FNV_OFFSET_BASIS, 0};
+    };
+    bool hasJapanese = false;
+
+    // Same splitting as appendWords(). Words are hashed in their re-encoded form so the hashes match splitWords().
+    for (size_t i = 0; i < text.size();) {
+        const size_t asciiEnd = i + Utf8::countAsciiPrefix(text.substr(i));
+        for (; i < asciiEnd; ++i) {
+            const unsigned char c = static_cast<unsigned char>(text[i]);
+            if (std::isalnum(c)) {
+                current.hash = hashLowercaseByte(current.hash, c);
+                ++current.length;
+            } else {
+                flush();
+            }
+        }
+        if (i == text.size()) {
+            break;
+        }
+
+        uint32_t codepoint = 0;
+        const size_t length = Utf8::decodeCodepoint(text, i, codepoint);
+        if (length == 0) {
+            ++i;
+            continue;
+        }
+        i += length;
+        if (!isWordCodepoint(codepoint)) {
+            flush();
+            continue;
+        }
+        hasJapanese = hasJapanese || isJapaneseCodepoint(codepoint);
+
+        std::array<char, 4> encoded{};
+        const size_t encodedLength = Utf8::encodeCodepoint(codepoint, encoded);
+        for (size_t j = 0; j < encodedLength; ++j) {
+            current.hash = hashLowercaseByte(current.hash, static_cast<unsigned char>(encoded[j]));
+        }
+        current.length += static_cast<uint32_t>(encodedLength);
+    }
+    flush();
+
+    // Bigrams come after every word, so they never push a word out of the token array
+    if (!hasJapanese) {
+        return TokenizedText(textHash, text.size(), std::span(tokens.data(), tokenCount));
+    }
+    forEachCjkBigram(text, [&](const std::string_view bigram) {
+        if (tokenCount == tokens.size()) {
+            return;
+        }
+        TokenizedText::Token token{FNV_OFFSET_BASIS, static_cast<uint32_t>(bigram.size()), true};
+        for (const char c : bigram) {
+            token.hash = hashLowercaseByte(token.hash, static_cast<unsigned char>(c));
+        }
+        tokens[tokenCount++] = token;
+    });
+
+    return TokenizedText(textHash, text.size(), std::span(tokens.data(), tokenCount));
+}
+
+TokenizedText tokenize(const std::string_view text) {
+    if (Utf8::isAscii(text)) {
+        return tokenizeFolded(text);
+    }
+    const Normalization::FoldedText foldedText(text);
+    return tokenizeFolded(foldedText.view());
+}
+
+static bool isHiragana(const uint32_t codepoint) {
+    return codepoint >= 0x3040 && codepoint <= 0x309F;
+}
+
+static bool isKatakana(const uint32_t codepoint) {
+    return codepoint >= 0x30A0 && codepoint <= 0x30FF;
+}
+
+static bool isKanji(const uint32_t codepoint) {
+    return (codepoint >= 0x4E00 && codepoint <= 0x9FFF)
+        || (codepoint >= 0x3400 && codepoint <= 0x4DBF)
+        || (codepoint >= 0xF900 && codepoint <= 0xFAFF);
+}
+
+static bool isJapaneseCodepoint(const uint32_t codepoint) {
+    return isHiragana(codepoint)
+        || isKatakana(codepoint)
+        || isKanji(codepoint)
+        || codepoint == 0x3005;
+}
+
+static uint32_t toHiragana(const uint32_t codepoint) {
+    if (codepoint >= 0x30A1 && codepoint <= 0x30F6) {
+        return codepoint - 0x60;
+    }
+    return codepoint;
+}
+
+static bool isSmallVowel(const uint32_t codepoint) {
+    switch (codepoint) {
+        case 0x3041:
+        case 0x3043:
+        case 0x3045:
+        case 0x3047:
+        case 0x3049:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool isSmallY(const uint32_t codepoint) {
+    switch (codepoint) {
+        case 0x3083:
+        case 0x3085:
+        case 0x3087:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static const char* getSmallVowelRomaji(const uint32_t codepoint) {
+    switch (codepoint) {
+        case 0x3041:
+            return "a";
+        case 0x3043:
+            return "i";
+        case 0x3045:
+            return "u";
+        case 0x3047:
+            return "e";
+        case 0x3049:
+            return "o";
+        default:
+            return "";
+    }
+}
+
+static const char* getSmallYRomaji(const uint32_t codepoint) {
+    switch (codepoint) {
+        case 0x3083:
+            return "ya";
+        case 0x3085:
+            return "yu";
+        case 0x3087:
+            return "yo";
+        default:
+            return "";
+    }
+}
+
+static const char* kanaToRomaji(const uint32_t codepoint) {
+    switch (codepoint) {
+        case 0x3042: return "a";
+        case 0x3044: return "i";
+        case 0x3046: return "u";
+        case 0x3048: return "e";
+        case 0x304A: return "o";
+        case 0x304B: return "ka";
+        case 0x304D: return "ki";
+        case 0x304F: return "ku";
+        case 0x3051: return "ke";
+        case 0x3053: return "ko";
+        case 0x3055: return "sa";
+        case 0x3057: return "shi";
+        case 0x3059: return "su";
+        case 0x305B: return "se";
+        case 0x305D: return "so";
+        case 0x305F: return "ta";
+        case 0x3061: return "chi";
+        case 0x3064: return "tsu";
+        case 0x3066: return "te";
+        case 0x3068: return "to";
+        case 0x306A: return "na";
+        case 0x306B: return "ni";
+        case 0x306C: return "nu";
+        case 0x306D: return "ne";
+        case 0x306E: return "no";
+        case 0x306F: return "ha";
+        case 0x3072: return "hi";
+        case 0x3075: return "fu";
+        case 0x3078: return "he";
+        case 0x307B: return "ho";
+        case 0x307E: return "ma";
+        case 0x307F: return "mi";
+        case 0x3080: return "mu";
+        case 0x3081: return "me";
+        case 0x3082: return "mo";
+        case 0x3084: return "ya";
+        case 0x3086: return "yu";
+        case 0x3088: return "yo";
+        case 0x3089: return "ra";
+        case 0x308A: return "ri";
+        case 0x308B: return "ru";
+        case 0x308C: return "re";
+        case 0x308D: return "ro";
+        case 0x308F: return "wa";
+        case 0x3090: return "wi";
+        case 0x3091: return "we";
+        case 0x3092: return "o";
+        case 0x3093: return "n";
+        case 0x304C: return "ga";
+        case 0x304E: return "gi";
+        case 0x3050: return "gu";
+        case 0x3052: return "ge";
+        case 0x3054: return "go";
+        case 0x3056: return "za";
+        case 0x3058: return "ji";
+        case 0x305A: return "zu";
+        case 0x305C: return "ze";
+        case 0x305E: return "zo";
+        case 0x3060: return "da";
+        case 0x3062: return "ji";
+        case 0x3065: return "zu";
+        case 0x3067: return "de";
+        case 0x3069: return "do";
+        case 0x3070: return "ba";
+        case 0x3073: return "bi";
+        case 0x3076: return "bu";
+        case 0x3079: return "be";
+        case 0x307C: return "bo";
+        case 0x3071: return "pa";
+        case 0x3074: return "pi";
+        case 0x3077: return "pu";
+        case 0x307A: return "pe";
+        case 0x307D: return "po";
+        case 0x3094: return "vu";
+        case 0x3095: return "ka";
+        case 0x3096: return "ke";
+        default:
+            return "";
+    }
+}
+
+static char getLastVowel(const std::string& text) {
+    for (auto it = text.rbegin(); it != text.rend(); ++it) {
+        switch (*it) {
+            case 'a':
+            case 'i':
+            case 'u':
+            case 'e':
+            case 'o':
+                return *it;
+            default:
+                break;
+        }
+    }
+    return '\0';
+}
+
+static void appendSpaceIfNeeded(std::string& text) {
+    if (!text.empty() && text.back() != ' ') {
+        text.push_back(' ');
+    }
+}
+
+static void appendUtf8(std::string& text, const uint32_t codepoint) {
+    std::array<char, 4> encoded{};
+    text.append(encoded.data(), Utf8::encodeCodepoint(codepoint, encoded));
+}
+
+static std::string doubleLeadingConsonant(const std::string& romaji) {
+    if (romaji.empty()) {
+        return romaji;
+    }
+    const char first = romaji.front();
+    if (first == 'a' || first == 'i' || first == 'u' || first == 'e' || first == 'o') {
+        return romaji;
+    }
+    return std::string(1, first) + romaji;
+}
+
+static std::string combineYoon(const std::string& base, const uint32_t smallY) {
+    const char* y = getSmallYRomaji(smallY);
+    if (!y || y[0] == '\0') {
+        return "";
+    }
+
+    if (base == "shi") {
+        return std::string("sh") + y;
+    }
+    if (base == "chi") {
+        return std::string("ch") + y;
+    }
+    if (base == "ji") {
+        return std::string("j") + y;
+    }
+    if (!base.empty() && base.back() == 'i') {
+        return base.substr(0, base.size() - 1) + y;
+    }
+    return "";
+}
+
+static std::string combineSmallVowel(const std::string& base, const uint32_t smallVowel) {
+    const char* vowel = getSmallVowelRomaji(smallVowel);
+    if (!vowel || vowel[0] == '\0') {
+        return "";
+    }
+
+    const char v = vowel[0];
+    if (base == "fu") {
+        return std::string("f") + vowel;
+    }
+    if (base == "vu") {
+        return std::string("v") + vowel;
+    }
+    if (base == "te" && v == 'i') {
+        return "ti";
+    }
+    if (base == "de" && v == 'i') {
+        return "di";
+    }
+    if (base == "to" && v == 'u') {
+        return "tu";
+    }
+    if (base == "do" && v == 'u') {
+        return "du";
+    }
+    if (base == "shi" && v == 'e') {
+        return "she";
+    }
+    if (base == "chi" && v == 'e') {
+        return "che";
+    }
+    if (base == "ji" && v == 'e') {
+        return "je";
+    }
+    if (base == "su" && v == 'i') {
+        return "si";
+    }
+    if (base == "zu" && v == 'i') {
+        return "zi";
+    }
+    if (base == "tsu") {
+        switch (v) {
+            case 'a': return "tsa";
+            case 'i': return "tsi";
+            case 'e': return "tse";
+            case 'o': return "tso";
+            default: break;
+        }
+    }
+    if (base == "ku") {
+        switch (v) {
+            case 'a': return "kwa";
+            case 'i': return "kwi";
+            case 'e': return "kwe";
+            case 'o': return "kwo";
+            default: break;
+        }
+    }
+    if (base == "gu") {
+        switch (v) {
+            case 'a': return "gwa";
+            case 'i': return "gwi";
+            case 'e': return "gwe";
+            case 'o': return "gwo";
+            default: break;
+        }
+    }
+    return "";
+}
+
+static std::vector<uint32_t> decodeUtf8(const std::string& text, bool& hasKana, bool& hasKanji) {
+    std::vector<uint32_t> codepoints;
+    codepoints.reserve(text.size());
+    hasKana = false;
+    hasKanji = false;
+    for (size_t i = 0; i < text.size();) {
+        uint32_t codepoint = 0;
+        const size_t length = Utf8::decodeCodepoint(text, i, codepoint);
+        if (length == 0) {
+            ++i;
+            continue;
+        }
+        i += length;
+        codepoints.push_back(codepoint);
+        if (length == 1) {
+            continue;
+        }
+        if (isHiragana(codepoint) || isKatakana(codepoint) || codepoint == 0x30FC) {
+            hasKana = true;
+        } else if (isKanji(codepoint)) {
+            hasKanji = true;
+        }
+    }
+
+    return codepoints;
+}
+
+static std::thread::id mainThreadId;
+
+void captureMainThreadId() {
+    if (mainThreadId == std::thread::id()) {
+        mainThreadId = std::this_thread::get_id();
+    }
+}
+
+static bool isOnMainThread() {
+    return mainThreadId != std::thread::id() && std::this_thread::get_id() == mainThreadId;
+}
+
+// The overrides file is checked for changes at most this often
+static constexpr std::chrono::seconds ROMAJI_OVERRIDES_CHECK_INTERVAL{5};
+
+struct RomajiOverridesFileState {
+    bool exists = false;
+    std::filesystem::file_time_type lastWriteTime;
+    uintmax_t size = 0;
+
+    bool operator==(const RomajiOverridesFileState&) const = default;
+};
+
+static std::once_flag romajiOverridesInitFlag;
+
+// Guards romajiOverrides and romajiOverridesFileState. The automaton itself is immutable and used without the lock.
+static std::mutex romajiOverridesMutex;
+static std::shared_ptr<const AirbudsSearch::AhoCorasick> romajiOverrides = std::make_shared<const AirbudsSearch::AhoCorasick>();
+static RomajiOverridesFileState romajiOverridesFileState;
+
+// Steady clock time of the next check for changes
+static std::atomic<std::chrono::steady_clock::rep> nextRomajiOverridesCheck = 0;
+
+// Hash of the loaded overrides, so cached romanizations made with other overrides are dropped. Only depends on the
+// contents of the file, so romanizations stored on disk stay valid across launches.
+static std::atomic<uint64_t> romajiOverridesHash = FNV_OFFSET_BASIS;
+
+static uint64_t hashBytes(uint64_t hash, const std::string_view bytes) {
+    for (const char c : bytes) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+    }
+    // Terminate every field, so that moving bytes from one field to the next changes the hash
+    return (hash ^ 0xFF) * FNV_PRIME;
+}
+
+static std::string trimAscii(const std::string& text) {
+    size_t start = 0;
+    while (start < text.size() && std::isspace(static_cast<unsigned char>(text[start]))) {
+        ++start;
+    }
+    if (start >= text.size()) {
+        return "";
+    }
+    size_t end = text.size() - 1;
+    while (end > start && std::isspace(static_cast<unsigned char>(text[end]))) {
+        --end;
+    }
+    return text.substr(start, end - start + 1);
+}
+
+static std::filesystem::path getRomajiOverridesPath() {
+#ifdef QUEST
+    return AirbudsSearch::getDataDirectory() / "romaji_overrides.txt";
+#else
+    // Desktop builds have no mod data directory
+    return std::filesystem::current_path() / "romaji_overrides.txt";
+#endif
+}
+
+static RomajiOverridesFileState getRomajiOverridesFileState(const std::filesystem::path& path) {
+    RomajiOverridesFileState state;
+    std::error_code error;
+    const std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return state;
+    }
+    const uintmax_t size = std::filesystem::file_size(path, error);
+    if (error) {
+        return state;
+    }
+    state.exists = true;
+    state.lastWriteTime = lastWriteTime;
+    state.size = size;
+    return state;
+}
+
+static std::vector<std::pair<std::string, std::string>> readRomajiOverrides(const std::filesystem::path& overridePath) {
+    std::vector<std::pair<std::string, std::string>> overrides;
+    std::ifstream file(overridePath, std::ios::binary);
+    if (!file.is_open()) {
+        AirbudsSearch::Log.warn("Romaji overrides file could not be opened: {}", overridePath.string());
+        return overrides;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        const std::string trimmed = trimAscii(line);
+        if (trimmed.empty() || trimmed.front() == '#') {
+            continue;
+        }
+        size_t delimiter = trimmed.find('=');
+        if (delimiter == std::string::npos) {
+            delimiter = trimmed.find('\t');
+        }
+        if (delimiter == std::string::npos) {
+            continue;
+        }
+        std::string source = trimAscii(trimmed.substr(0, delimiter));
+        std::string romaji = trimAscii(trimmed.substr(delimiter + 1));
+        if (source.empty() || romaji.empty()) {
+            continue;
+        }
+        overrides.emplace_back(std::move(source), std::move(romaji));
+    }
+
+    if (!overrides.empty()) {
+        AirbudsSearch::Log.info("Loaded {} romaji overrides from {}", overrides.size(), overridePath.string());
+    } else {
+        AirbudsSearch::Log.warn("Romaji overrides file is empty: {}", overridePath.string());
+    }
+    return overrides;
+}
+
+static void reloadRomajiOverridesIfChanged() {
+    nextRomajiOverridesCheck = (std::chrono::steady_clock::now() + ROMAJI_OVERRIDES_CHECK_INTERVAL).time_since_epoch().count();
+
+    const std::filesystem::path overridePath = getRomajiOverridesPath();
+    const RomajiOverridesFileState fileState = getRomajiOverridesFileState(overridePath);
+    {
+        std::lock_guard lock(romajiOverridesMutex);
+        if (fileState == romajiOverridesFileState) {
+            return;
+        }
+        romajiOverridesFileState = fileState;
+    }
+
+    std::vector<std::pair<std::string, std::string>> overrides;
+    if (fileState.exists) {
+        overrides = readRomajiOverrides(overridePath);
+    } else {
+        AirbudsSearch::Log.info("Romaji overrides file was removed: {}", overridePath.string());
+    }
+
+    // Compiled once, so applying the overrides is a single pass over the text however many there are
+    auto automaton = std::make_shared<const AirbudsSearch::AhoCorasick>(overrides);
+    uint64_t overridesHash = FNV_OFFSET_BASIS;
+    for (const auto& [source, romaji] : overrides) {
+        overridesHash = hashBytes(hashBytes(overridesHash, source), romaji);
+    }
+    {
+        std::lock_guard lock(romajiOverridesMutex);
+        romajiOverrides = std::move(automaton);
+    }
+    romajiOverridesHash = overridesHash;
+}
+
+static void loadRomajiOverrides() {
+    // The first caller waits for the overrides, so no search runs without them
+    std::call_once(romajiOverridesInitFlag, reloadRomajiOverridesIfChanged);
+
+    // Afterwards, one caller at a time checks the file for changes while the others keep using the loaded overrides
+    const std::chrono::steady_clock::rep now = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::chrono::steady_clock::rep nextCheck = nextRomajiOverridesCheck.load(std::memory_order_relaxed);
+    if (now >= nextCheck && nextRomajiOverridesCheck.compare_exchange_strong(nextCheck, std::numeric_limits<std::chrono::steady_clock::rep>::max())) {
+        reloadRomajiOverridesIfChanged();
+    }
+}
+
+static std::string applyRomajiOverrides(const std::string& text) {
+    loadRomajiOverrides();
+    std::shared_ptr<const AirbudsSearch::AhoCorasick> overrides;
+    {
+        std::lock_guard lock(romajiOverridesMutex);
+        overrides = romajiOverrides;
+    }
+    if (overrides->getPatternCount() == 0 || text.empty()) {
+        return text;
+    }
+    return overrides->replaceAll(text);
+}
+
+static std::once_flag converterInitFlag;
+static const AirbudsSearch::IJapaneseConverter* externalConverter = nullptr;
+// Set if the converter implements version 2. externalConverter then points to externalConverterV1View.
+static const AirbudsSearch::IJapaneseConverterV2* externalConverterV2 = nullptr;
+static AirbudsSearch::IJapaneseConverter externalConverterV1View;
+static std::string externalConverterName;
+// Identifies the loaded converter across launches: a hash of its name and API version, or 0 without a converter
+static uint64_t externalConverterHash = 0;
+static std::once_flag converterMissingLogFlag;
+static std::once_flag converterInvalidLogFlag;
+static std::once_flag converterFailureLogFlag;
+
+// Converted segments of a batch, looked up before calling the converter. Only set on the thread that warms the
+// RomanizationCache, while it romanizes the batch.
+static thread_local const std::unordered_map<std::string, std::string>* batchConversions = nullptr;
+
+static void* findConverterSymbol(const char* name) {
+    void* symbol = nullptr;
+#ifdef QUEST
+    CModInfo modInfo{"airbuds-search-kakasi", "0.0.0", 0};
+    CModResult mod = modloader_get_mod(&modInfo, MatchType_IdOnly);
+    if (mod.handle) {
+        symbol = dlsym(mod.handle, name);
+    }
+#endif
+    if (!symbol) {
+        symbol = dlsym(RTLD_DEFAULT, name);
+    }
+    return symbol;
+}
+
+static const AirbudsSearch::IJapaneseConverter* loadExternalJapaneseConverter() {
+    std::call_once(converterInitFlag, []() {
+        // Prefer version 2, and fall back to version 1 for older adapter mods
+        if (void* symbol = findConverterSymbol(AirbudsSearch::kJapaneseConverterV2Symbol)) {
+            auto getConverter = reinterpret_cast<AirbudsSearch::GetJapaneseConverterV2Fn>(symbol);
+            const AirbudsSearch::IJapaneseConverterV2* converter = getConverter ? getConverter() : nullptr;
+            if (converter && converter->apiVersion == 2 && converter->convert && converter->getConvertedSize && converter->convertBatch) {
+                externalConverterV2 = converter;
+                externalConverterV1View.apiVersion = converter->apiVersion;
+                externalConverterV1View.name = converter->name;
+                externalConverterV1View.convert = converter->convert;
+                externalConverter = &externalConverterV1View;
+            } else {
+                AirbudsSearch::Log.warn("Japanese converter v2 API mismatch; trying v1.");
+            }
+        }
+
+        if (!externalConverter) {
+            void* symbol = findConverterSymbol(AirbudsSearch::kJapaneseConverterSymbol);
+            if (!symbol) {
+                std::call_once(converterMissingLogFlag, []() {
+                    AirbudsSearch::Log.info("Japanese converter mod not found; romaji will be kana-only.");
+                });
+                return;
+            }
+
+            auto getConverter = reinterpret_cast<AirbudsSearch::GetJapaneseConverterFn>(symbol);
+            const AirbudsSearch::IJapaneseConverter* converter = getConverter ? getConverter() : nullptr;
+            if (!converter || converter->apiVersion != 1 || !converter->convert) {
+                std::call_once(converterInvalidLogFlag, []() {
+                    AirbudsSearch::Log.warn("Japanese converter API mismatch; romaji will be kana-only.");
+                });
+                return;
+            }
+            externalConverter = converter;
+        }
+
+        externalConverterName = externalConverter->name ? externalConverter->name : "unknown";
+        externalConverterHash = hashBytes(hashBytes(FNV_OFFSET_BASIS, externalConverterName), std::to_string(externalConverter->apiVersion));
+        AirbudsSearch::Log.info("Japanese converter loaded: {} (API v{})", externalConverterName, externalConverter->apiVersion);
+    });
+    return externalConverter;
+}
+
+static void logConverterFailure() {
+    std::call_once(converterFailureLogFlag, []() {
+        AirbudsSearch::Log.warn("Japanese converter failed to convert text.");
+    });
+}
+
+static std::string romanizeWithExternalConverter(const std::string& text) {
+    const AirbudsSearch::IJapaneseConverter* converter = loadExternalJapaneseConverter();
+    if (!converter || text.empty()) {
+        return "";
+    }
+    if (batchConversions) {
+        const auto it = batchConversions->find(text);
+        if (it != batchConversions->end()) {
+            return it->second;
+        }
+    }
+
+    std::string output;
+    if (externalConverterV2) {
+        // The converter knows how long the output is, so it never fails for lack of space
+        const size_t size = externalConverterV2->getConvertedSize(text.c_str());
+        if (size == 0) {
+            logConverterFailure();
+            return "";
+        }
+        output.resize(size);
+    } else {
+        output.resize(text.size() * 4 + 32);
+    }
+    if (!converter->convert(text.c_str(), output.data(), output.size())) {
+        logConverterFailure();
+        return "";
+    }
+
+    output.resize(std::strlen(output.c_str()));
+    return output;
+}
+
+// Initial arena size for batch conversions, per byte of input
+static constexpr size_t ROMAJI_BYTES_PER_INPUT_BYTE = 3;
+
+/**
+ * Converts all the texts with a single call to the converter, if it supports batches. Texts that failed to convert
+ * map to an empty string, same as romanizeWithExternalConverter() returns for them.
+ */
+static std::unordered_map<std::string, std::string> convertBatchWithExternalConverter(const std::vector<std::string>& texts) {
+    std::unordered_map<std::string, std::string> conversions;
+    if (texts.empty() || !loadExternalJapaneseConverter() || !externalConverterV2) {
+        return conversions;
+    }
+
+    std::vector<const char*> pointers;
+    pointers.reserve(texts.size());
+    size_t arenaSize = 0;
+    for (const std::string& text : texts) {
+        pointers.push_back(text.c_str());
+        // Romaji is usually longer than the UTF-8 kanji it comes from: 東京 is 6 bytes and "toukyou" 7. Three bytes of
+        // output per input byte covers even long readings, so a sync almost never needs the second call.
+        arenaSize += (text.size() * ROMAJI_BYTES_PER_INPUT_BYTE) + 1;
+    }
+    std::vector<size_t> offsets(texts.size());
+    std::string arena;
+
+    // Try once with the estimate, and again with the size the converter asks for if it still didn't fit
+    bool converted = false;
+    for (int attempt = 0; attempt < 2 && !converted; ++attempt) {
+        arena.resize(arenaSize);
+        size_t requiredSize = 0;
+        converted = externalConverterV2->convertBatch(pointers.data(), pointers.size(), arena.data(), arena.size(), offsets.data(), &requiredSize);
+        if (!converted) {
+            if (requiredSize <= arenaSize) {
+                break;
+            }
+            arenaSize = requiredSize;
+        }
+    }
+    if (!converted) {
+        logConverterFailure();
+        return conversions;
+    }
+
+    conversions.reserve(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        std::string romaji;
+        if (offsets[i] < arena.size()) {
+            romaji = arena.c_str() + offsets[i];
+        }
+        conversions.emplace(texts[i], std::move(romaji));
+    }
+    return conversions;
+}
+
+static std::string normalizeRomajiAscii(const std::string& text) {
+    std::string normalized;
+    normalized.reserve(text.size());
+    for (unsigned char c : text) {
+        if (std::isalnum(c)) {
+            normalized.push_back(static_cast<char>(std::tolower(c)));
+        }
+    }
+    return normalized;
+}
+
+static std::string romanizeKanaOnly(const std::vector<uint32_t>& codepoints) {
+    std::string output;
+    bool doubleConsonant = false;
+
+    for (size_t i = 0; i < codepoints.size(); ++i) {
+        uint32_t codepoint = codepoints[i];
+
+        if (codepoint <= 0x7F) {
+            output.push_back(static_cast<char>(codepoint));
+            continue;
+        }
+
+        if (codepoint == 0x3000 || codepoint == 0x30FB) {
+            appendSpaceIfNeeded(output);
+            continue;
+        }
+
+        if (codepoint == 0x30FC) {
+            const char vowel = getLastVowel(output);
+            if (vowel != '\0') {
+                output.push_back(vowel);
+            }
+            continue;
+        }
+
+        if (isKatakana(codepoint)) {
+            codepoint = toHiragana(codepoint);
+        }
+
+        if (isHiragana(codepoint)) {
+            if (codepoint == 0x3063) {
+                doubleConsonant = true;
+                continue;
+            }
+
+            uint32_t nextCodepoint = 0;
+            if (i + 1 < codepoints.size()) {
+                nextCodepoint = codepoints[i + 1];
+                if (isKatakana(nextCodepoint)) {
+                    nextCodepoint = toHiragana(nextCodepoint);
+                }
+            }
+
+            const std::string base = kanaToRomaji(codepoint);
+            if (!base.empty()) {
+                if (isSmallY(nextCodepoint)) {
+                    std::string combined = combineYoon(base, nextCodepoint);
+                    if (!combined.empty()) {
+                        if (doubleConsonant) {
+                            combined = doubleLeadingConsonant(combined);
+                        }
+                        output += combined;
+                        doubleConsonant = false;
+                        ++i;
+                        continue;
+                    }
+                }
+
+                if (isSmallVowel(nextCodepoint)) {
+                    std::string combined = combineSmallVowel(base, nextCodepoint);
+                    if (!combined.empty()) {
+                        if (doubleConsonant) {
+                            combined = doubleLeadingConsonant(combined);
+                        }
+                        output += combined;
+                        doubleConsonant = false;
+                        ++i;
+                        continue;
+                    }
+                }
+
+                std::string romaji = base;
+                if (doubleConsonant) {
+                    romaji = doubleLeadingConsonant(romaji);
+                }
+                output += romaji;
+                doubleConsonant = false;
+                continue;
+            }
+
+            if (isSmallVowel(codepoint)) {
+                const char* vowel = getSmallVowelRomaji(codepoint);
+                if (vowel[0] != '\0') {
+                    output += vowel;
+                }
+                continue;
+            }
+
+            if (isSmallY(codepoint)) {
+                const char* y = getSmallYRomaji(codepoint);
+                if (y[0] != '\0') {
+                    output += y;
+                }
+                continue;
+            }
+
+            appendSpaceIfNeeded(output);
+            doubleConsonant = false;
+            continue;
+        }
+
+        appendSpaceIfNeeded(output);
+    }
+
+    return output;
+}
+
+static std::string romanizeJapaneseSegment(
+    const std::string& text,
+    const std::vector<uint32_t>& codepoints,
+    const bool hasKana,
+    const bool hasKanji) {
+    if (hasKanji) {
+        const std::string romaji = romanizeWithExternalConverter(text);
+        if (!romaji.empty()) {
+            if (hasKana) {
+                const std::string kanaOnly = romanizeKanaOnly(codepoints);
+                if (!kanaOnly.empty()
+                    && normalizeRomajiAscii(romaji) == normalizeRomajiAscii(kanaOnly)) {
+                    return "";
+                }
+            }
+            return romaji;
+        }
+        if (hasKana) {
+            return romanizeKanaOnly(codepoints);
+        }
+        return "";
+    }
+    if (!hasKana) {
+        return "";
+    }
+    return romanizeKanaOnly(codepoints);
+}
+
+// Bump when romanizeJapaneseUncached() changes its output, so romanizations stored on disk are redone
+static constexpr uint64_t ROMANIZER_VERSION = 1;
+
+static uint64_t getRomanizationVersion() {
+    loadRomajiOverrides();
+    loadExternalJapaneseConverter();
+    return (romajiOverridesHash.load() ^ externalConverterHash) * FNV_PRIME + ROMANIZER_VERSION;
+}
+
+static std::string romanizeJapaneseUncached(const std::string& text) {
+    const std::string input = applyRomajiOverrides(text);
+    const bool overridesApplied = input != text;
+    bool hasKana = false;
+    bool hasKanji = false;
+
+    // ASCII text has no Japanese in it, so it isn't decoded at all
+    std::vector<uint32_t> codepoints;
+    if (!Utf8::isAscii(input)) {
+        codepoints = decodeUtf8(input, hasKana, hasKanji);
+    }
+    if (!hasKana && !hasKanji) {
+        if (!overridesApplied) {
+            return "";
+        }
+        std::string output;
+        output.reserve(input.size());
+        for (unsigned char c : input) {
+            if (std::isalnum(c)) {
+                output.push_back(static_cast<char>(std::tolower(c)));
+            } else {
+                appendSpaceIfNeeded(output);
+            }
+        }
+        if (!output.empty() && output.back() == ' ') {
+            output.pop_back();
+        }
+        return output;
+    }
+
+    std::string output;
+    std::string jpSegment;
+    std::vector<uint32_t> jpCodepoints;
+    bool segmentHasKana = false;
+    bool segmentHasKanji = false;
+
+    auto flushSegment = [&]() {
+        if (jpSegment.empty()) {
+            return;
+        }
+        const std::string romaji = romanizeJapaneseSegment(jpSegment, jpCodepoints, segmentHasKana, segmentHasKanji);
+        if (!romaji.empty()) {
+            appendSpaceIfNeeded(output);
+            output += romaji;
+        }
+        jpSegment.clear();
+        jpCodepoints.clear();
+        segmentHasKana = false;
+        segmentHasKanji = false;
+    };
+
+    for (const uint32_t codepoint : codepoints) {
+        if (isJapaneseCodepoint(codepoint)) {
+            appendUtf8(jpSegment, codepoint);
+            jpCodepoints.push_back(codepoint);
+            if (isKanji(codepoint)) {
+                segmentHasKanji = true;
+            } else if (isHiragana(codepoint) || isKatakana(codepoint)) {
+                segmentHasKana = true;
+            }
+            continue;
+        }
+
+        flushSegment();
+
+        if (codepoint <= 0x7F) {
+            const unsigned char ascii = static_cast<unsigned char>(codepoint);
+            if (std::isalnum(ascii)) {
+                output.push_back(static_cast<char>(std::tolower(ascii)));
+            } else {
+                appendSpaceIfNeeded(output);
+            }
+            continue;
+        }
+
+        appendSpaceIfNeeded(output);
+    }
+
+    flushSegment();
+    if (!output.empty() && output.back() == ' ') {
+        output.pop_back();
+    }
+
+    return output;
+}
+
+// Appends the parts of the text that romanizeJapaneseUncached() would pass to the converter
+static void collectConverterSegments(const std::string& text, std::vector<std::string>& segments) {
+    const std::string input = applyRomajiOverrides(text);
+    if (Utf8::isAscii(input)) {
+        return;
+    }
+    bool hasKana = false;
+    bool hasKanji = false;
+    const std::vector<uint32_t> codepoints = decodeUtf8(input, hasKana, hasKanji);
+    if (!hasKanji) {
+        return;
+    }
+
+    std::string segment;
+    bool segmentHasKanji = false;
+    auto flushSegment = [&]() {
+        if (segmentHasKanji) {
+            segments.push_back(segment);
+        }
+        segment.clear();
+        segmentHasKanji = false;
+    };
+    for (const uint32_t codepoint : codepoints) {
+        if (isJapaneseCodepoint(codepoint)) {
+            appendUtf8(segment, codepoint);
+            segmentHasKanji = segmentHasKanji || isKanji(codepoint);
+        } else {
+            flushSegment();
+        }
+    }
+    flushSegment();
+}
+
+std::string romanizeJapanese(const std::string& text) {
+    if (text.empty()) {
+        return "";
+    }
+
+    // The same titles come up in many queries and searches, so remember the result
+    RomanizationCache& romanizationCache = RomanizationCache::getInstance();
+    const uint64_t version = getRomanizationVersion();
+    if (std::optional<std::string> romaji = romanizationCache.get(text, version)) {
+        return std::move(*romaji);
+    }
+    std::string romaji = romanizeJapaneseUncached(text);
+    romanizationCache.put(text, romaji, version);
+    return romaji;
+}
+
+std::string getTrackRomajiCached(const airbuds::Track& track) {
+    if (track.name.empty()) {
+        return "";
+    }
+    return romanizeJapanese(track.name);
+}
+
+void warmRomanizationCache(const std::vector<airbuds::PlaylistTrack>& tracks) {
+    std::vector<std::string> texts;
+    texts.reserve(tracks.size() * 2);
+    for (const airbuds::PlaylistTrack& track : tracks) {
+        texts.push_back(track.name);
+        for (const airbuds::Artist& artist : track.artists) {
+            texts.push_back(artist.name);
+        }
+    }
+    if (texts.empty()) {
+        return;
+    }
+
+    std::thread([texts = std::move(texts)]() {
+        // Same as the prefetcher, this shouldn't compete with the game or a foreground search
+        setpriority(PRIO_PROCESS, 0, 10);
+
+        const auto start = std::chrono::steady_clock::now();
+        RomanizationCache& romanizationCache = RomanizationCache::getInstance();
+        const uint64_t version = getRomanizationVersion();
+        std::vector<const std::string*> missingTexts;
+        for (const std::string& text : texts) {
+            if (!text.empty() && !romanizationCache.get(text, version)) {
+                missingTexts.push_back(&text);
+            }
+        }
+
+        // Convert the kanji of every missing text with one call to the converter, then romanize the texts with those
+        std::vector<std::string> segments;
+        for (const std::string* text : missingTexts) {
+            collectConverterSegments(*text, segments);
+        }
+        std::sort(segments.begin(), segments.end());
+        segments.erase(std::unique(segments.begin(), segments.end()), segments.end());
+        const std::unordered_map<std::string, std::string> conversions = convertBatchWithExternalConverter(segments);
+        batchConversions = &conversions;
+        for (const std::string* text : missingTexts) {
+            romanizeJapanese(*text);
+        }
+        batchConversions = nullptr;
+
+        romanizationCache.save();
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        AirbudsSearch::Log.info("Warmed romanization cache: texts = {} romanized = {} batched = {} time = {}ms", texts.size(), missingTexts.size(), conversions.size(), elapsed.count());
+    }).detach();
+}
+
+static std::string normalizeQueryWhitespace(const std::string& text) {
+    std::string output;
+    output.reserve(text.size());
+    bool inWhitespace = false;
+    for (unsigned char c : text) {
+        if (std::isspace(c)) {
+            if (!output.empty() && !inWhitespace) {
+                output.push_back(' ');
+                inWhitespace = true;
+            }
+            continue;
+        }
+        output.push_back(static_cast<char>(c));
+        inWhitespace = false;
+    }
+    if (!output.empty() && output.back() == ' ') {
+        output.pop_back();
+    }
+    return output;
+}
+
+static std::string joinWords(const std::vector<std::string>& words) {
+    std::string output;
+    for (const std::string& word : words) {
+        if (word.empty()) {
+            continue;
+        }
+        if (!output.empty()) {
+            output.push_back(' ');
+        }
+        output.append(word);
+    }
+    return normalizeQueryWhitespace(output);
+}
+
+static std::string buildQueryFromText(const std::string& text) {
+    const std::vector<std::string> words = getWords(text);
+    if (words.empty()) {
+        return normalizeQueryWhitespace(text);
+    }
+    return joinWords(words);
+}
+
+static size_t countAsciiAlnum(const std::string& text) {
+    size_t count = 0;
+    for (unsigned char c : text) {
+        if (std::isalnum(c)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+static bool isUsefulRomajiQuery(const std::string& romajiQuery) {
+    if (romajiQuery.empty()) {
+        return false;
+    }
+    if (romajiQuery.find(' ') != std::string::npos) {
+        return true;
+    }
+    return countAsciiAlnum(romajiQuery) >= 4;
+}
+
+static void addUniqueQuery(std::vector<std::string>& queries, std::unordered_set<std::string>& seen, const std::string& rawQuery) {
+    const std::string normalized = normalizeQueryWhitespace(rawQuery);
+    if (normalized.empty()) {
+        return;
+    }
+    std::string key = normalizeRomajiAscii(normalized);
+    if (key.empty()) {
+        key = normalized;
+    }
+    if (seen.insert(key).second) {
+        queries.push_back(normalized);
+    }
+}
+
+std::vector<ArtistMatchInfo> buildArtistInfos(const std::vector<airbuds::Artist>& artists) {
+    std::vector<ArtistMatchInfo> infos;
+    infos.reserve(artists.size());
+    for (const airbuds::Artist& artist : artists) {
+        ArtistMatchInfo info;
+        info.name = artist.name;
+        info.romaji = romanizeJapanese(artist.name);
+        info.nameTokens = tokenize(info.name);
+        info.romajiTokens = tokenize(info.romaji);
+        infos.push_back(std::move(info));
+    }
+    return infos;
+}
+
+TrackMatchInfo buildTrackMatchInfo(const airbuds::Track& track) {
+    TrackMatchInfo info;
+    info.romaji = getTrackRomajiCached(track);
+    info.nameTokens = tokenize(track.name);
+    info.romajiTokens = tokenize(info.romaji);
+    info.namePattern = FuzzyMatch::Pattern(track.name);
+    info.romajiPattern = FuzzyMatch::Pattern(info.romaji);
+    info.artists = buildArtistInfos(track.artists);
+    return info;
+}
+
+std::string getArtistRomajiLog(const std::vector<ArtistMatchInfo>& infos) {
+    std::string output;
+    for (const auto& info : infos) {
+        if (info.romaji.empty()) {
+            continue;
+        }
+        if (!output.empty()) {
+            output += ", ";
+        }
+        output += info.romaji;
+    }
+    return output;
+}
+
+static void addQuerySpec(
+    std::vector<QuerySpec>& queries,
+    std::unordered_map<std::string, size_t>& seen,
+    const std::string& rawQuery,
+    std::string_view label,
+    int baseScore) {
+    const std::string normalized = normalizeQueryWhitespace(rawQuery);
+    if (normalized.empty()) {
+        return;
+    }
+    std::string key = normalizeRomajiAscii(normalized);
+    if (key.empty()) {
+        key = normalized;
+    }
+    auto it = seen.find(key);
+    if (it != seen.end()) {
+        QuerySpec& existing = queries[it->second];
+        if (baseScore > existing.baseScore) {
+            existing.baseScore = baseScore;
+            existing.label = std::string(label);
+        }
+        return;
+    }
+    QuerySpec spec;
+    spec.query = normalized;
+    spec.label = std::string(label);
+    spec.baseScore = baseScore;
+    seen.emplace(key, queries.size());
+    queries.push_back(std::move(spec));
+}
+
+std::vector<QuerySpec> buildBeatSaverQueries(const airbuds::Track& track, const std::vector<ArtistMatchInfo>& artistInfos) {
+    std::vector<QuerySpec> queries;
+    std::unordered_map<std::string, size_t> seen;
+
+    const std::string nameQuery = buildQueryFromText(track.name);
+    addQuerySpec(queries, seen, nameQuery, "name", 1500);
+
+    std::string artistQuery;
+    std::string artistRomajiQuery;
+    if (!artistInfos.empty()) {
+        artistQuery = buildQueryFromText(artistInfos.front().name);
+        artistRomajiQuery = buildQueryFromText(artistInfos.front().romaji);
+    }
+    if (!nameQuery.empty() && !artistQuery.empty()) {
+        addQuerySpec(queries, seen, nameQuery + " " + artistQuery, "name+artist", 2000);
+    }
+    if (!nameQuery.empty()
+        && isUsefulRomajiQuery(artistRomajiQuery)
+        && normalizeRomajiAscii(artistRomajiQuery) != normalizeRomajiAscii(artistQuery)) {
+        addQuerySpec(queries, seen, nameQuery + " " + artistRomajiQuery, "name+artistRomaji", 1800);
+    }
+
+    const std::string romaji = getTrackRomajiCached(track);
+    const std::string romajiQuery = buildQueryFromText(romaji);
+    if (isUsefulRomajiQuery(romajiQuery)
+        && normalizeRomajiAscii(romajiQuery) != normalizeRomajiAscii(nameQuery)) {
+        addQuerySpec(queries, seen, romajiQuery, "romaji", 1200);
+        if (!artistQuery.empty()) {
+            addQuerySpec(queries, seen, romajiQuery + " " + artistQuery, "romaji+artist", 1400);
+        }
+        if (!artistRomajiQuery.empty()) {
+            addQuerySpec(queries, seen, romajiQuery + " " + artistRomajiQuery, "romaji+artistRomaji", 1300);
+        }
+    }
+
+    std::stable_sort(queries.begin(), queries.end(), [](const QuerySpec& a, const QuerySpec& b) {
+        return a.baseScore > b.baseScore;
+    });
+
+    return queries;
+}
+
+int scoreTextMatch(const std::string& needle, const std::string& haystack) {
+    return scoreTextMatch(tokenize(needle), tokenize(haystack));
+}
+
+// Score of every shared bigram of a Japanese run. Lower than a shared word, since the bigrams of a run add up: a title
+// that only shares half of a long run still scores about as much as one shared word.
+static constexpr int CJK_BIGRAM_SCORE = 15;
+
+// Score of a text that is the same as the needle
+static constexpr int SAME_TEXT_SCORE = 800;
+
+// Score of a needle word that is in the haystack
+static int getWordMatchScore(const TokenizedText::Token& token) {
+    if (token.isBigram) {
+        return CJK_BIGRAM_SCORE;
+    }
+    return 40 + static_cast<int>(std::min<uint32_t>(token.length, 8)) * 5;
+}
+
+int scoreTextMatch(const TokenizedText& needle, const TokenizedText& haystack) {
+    if (needle.isTextEmpty() || haystack.isTextEmpty()) {
+        return 0;
+    }
+    if (needle.isSameText(haystack)) {
+        return SAME_TEXT_SCORE;
+    }
+
+    // Both token lists are sorted by hash, so one merge pass finds every needle word that is in the haystack. Repeated
+    // needle words count every time.
+    const std::span<const TokenizedText::Token> needleTokens = needle.getTokens();
+    const std::span<const TokenizedText::Token> haystackTokens = haystack.getTokens();
+    int score = 0;
+    size_t haystackIndex = 0;
+    for (const TokenizedText::Token& token : needleTokens) {
+        while (haystackIndex < haystackTokens.size() && haystackTokens[haystackIndex].hash < token.hash) {
+            ++haystackIndex;
+        }
+        if (haystackIndex == haystackTokens.size()) {
+            break;
+        }
+        if (haystackTokens[haystackIndex].hash != token.hash) {
+            continue;
+        }
+        score += getWordMatchScore(token);
+    }
+    return score;
+}
+
+int getMaxTextMatchScore(const TokenizedText& needle) {
+    if (needle.isTextEmpty()) {
+        return 0;
+    }
+
+    // A long title that shares every word can score more than the same text
+    int wordScore = 0;
+    for (const TokenizedText::Token& token : needle.getTokens()) {
+        wordScore += getWordMatchScore(token);
+    }
+    return std::max(SAME_TEXT_SCORE, wordScore);
+}
+
+} // namespace AirbudsSearch::Filter
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "FuzzyMatch.hpp"
+#include "Normalization.hpp"
+#include "Utf8.hpp"
+
+namespace AirbudsSearch::FuzzyMatch {
+
+// Maps each ASCII character to its normalized form, or 0 if it is dropped
+static constexpr std::array<uint8_t, 128> ASCII_NORMALIZATION_TABLE = []() {
+    std::array<uint8_t, 128> table{};
+    for (uint8_t c = '0'; c <= '9'; ++c) {
+        table[c] = c;
+    }
+    for (uint8_t c = 'a'; c <= 'z'; ++c) {
+        table[c] = c;
+        table[c - 'a' + 'A'] = c;
+    }
+    return table;
+}();
+
+static constexpr uint64_t ASCII_CHUNK_MASK = 0x8080808080808080ULL;
+
+static NormalizedText normalizeFolded(const std::string_view text) {
+    NormalizedText normalized;
+    const auto push = [&normalized](const uint32_t symbol) {
+        if (normalized.length < MAX_LENGTH) {
+            normalized.symbols[normalized.length++] = symbol;
+        }
+    };
+
+    size_t i = 0;
+    while (i < text.size() && normalized.length < MAX_LENGTH) {
+        // Most names are plain ASCII, so check 8 bytes at a time and skip the UTF-8 decoding for them
+        if (i + 8 <= text.size()) {
+            uint64_t chunk = 0;
+            std::memcpy(&chunk, text.data() + i, sizeof(chunk));
+            if ((chunk & ASCII_CHUNK_MASK) == 0) {
+                for (size_t j = 0; j < 8; ++j) {
+                    const uint8_t symbol = ASCII_NORMALIZATION_TABLE[static_cast<uint8_t>(text[i + j])];
+                    if (symbol != 0) {
+                        push(symbol);
+                    }
+                }
+                i += 8;
+                continue;
+            }
+        }
+
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80) {
+            const uint8_t symbol = ASCII_NORMALIZATION_TABLE[c];
+            if (symbol != 0) {
+                push(symbol);
+            }
+            ++i;
+            continue;
+        }
+
+        uint32_t codepoint = 0;
+        const size_t length = Utf8::decodeCodepoint(text, i, codepoint);
+        if (length == 0) {
+            ++i;
+            continue;
+        }
+        i += length;
+
+        // CJK punctuation. Full-width forms were already folded to ASCII.
+        if (codepoint >= 0x3000 && codepoint <= 0x303F) {
+            continue;
+        }
+        normalized.isAscii = false;
+        push(codepoint);
+    }
+
+    // Code points fit in 21 bits, so three of them pack into one key without collisions
+    for (size_t k = 0; k + 2 < normalized.length; ++k) {
+        normalized.trigrams[normalized.trigramCount++] = (static_cast<uint64_t>(normalized.symbols[k]) << 42)
+            | (static_cast<uint64_t>(normalized.symbols[k + 1]) << 21)
+            | static_cast<uint64_t>(normalized.symbols[k + 2]);
+    }
+    const auto trigramsEnd = normalized.trigrams.begin() + normalized.trigramCount;
+    std::sort(normalized.trigrams.begin(), trigramsEnd);
+    normalized.trigramCount = std::unique(normalized.trigrams.begin(), trigramsEnd) - normalized.trigrams.begin();
+
+    return normalized;
+}
+
+NormalizedText normalize(const std::string_view text) {
+    if (Utf8::isAscii(text)) {
+        return normalizeFolded(text);
+    }
+    const Normalization::FoldedText foldedText(text);
+    return normalizeFolded(foldedText.view());
+}
+
+Pattern::Pattern(const std::string_view text) : text_(normalize(text)) {
+    for (size_t i = 0; i < text_.length; ++i) {
+        const uint32_t symbol = text_.symbols[i];
+        const uint64_t bit = 1ULL << i;
+        if (symbol < asciiMatchVectors_.size()) {
+            asciiMatchVectors_[symbol] |= bit;
+            continue;
+        }
+        const auto distinctSymbolsEnd = distinctSymbols_.begin() + distinctSymbolCount_;
+        const auto it = std::find(distinctSymbols_.begin(), distinctSymbolsEnd, symbol);
+        if (it != distinctSymbolsEnd) {
+            distinctSymbolMatchVectors_[it - distinctSymbols_.begin()] |= bit;
+        } else {
+            distinctSymbols_[distinctSymbolCount_] = symbol;
+            distinctSymbolMatchVectors_[distinctSymbolCount_] = bit;
+            ++distinctSymbolCount_;
+        }
+    }
+}
+
+uint64_t Pattern::getMatchVector(const uint32_t symbol) const {
+    if (symbol < asciiMatchVectors_.size()) {
+        return asciiMatchVectors_[symbol];
+    }
+    for (size_t i = 0; i < distinctSymbolCount_; ++i) {
+        if (distinctSymbols_[i] == symbol) {
+            return distinctSymbolMatchVectors_[i];
+        }
+    }
+    return 0;
+}
+
+size_t Pattern::getEditDistance(const NormalizedText& text) const {
+    const size_t patternLength = text_.length;
+    if (patternLength == 0) {
+        return text.length;
+    }
+
+    // Vertical deltas of the current DP column, one bit per pattern symbol: positive (pv) and negative (mv)
+    const uint64_t lastBit = 1ULL << (patternLength - 1);
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    size_t distance = patternLength;
+    for (size_t j = 0; j < text.length; ++j) {
+        // ASCII symbols are always in the table, so ASCII text never needs the distinct symbol search
+        const uint64_t eq = text.isAscii ? asciiMatchVectors_[text.symbols[j]] : getMatchVector(text.symbols[j]);
+        const uint64_t xv = eq | mv;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & lastBit) {
+            ++distance;
+        } else if (mh & lastBit) {
+            --distance;
+        }
+        // The first row of the DP matrix grows by one per text symbol
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return distance;
+}
+
+float getTrigramSimilarity(const NormalizedText& a, const NormalizedText& b) {
+    if (a.trigramCount == 0 || b.trigramCount == 0) {
+        return 0.0f;
+    }
+    size_t intersection = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.trigramCount && j < b.trigramCount) {
+        if (a.trigrams[i] < b.trigrams[j]) {
+            ++i;
+        } else if (b.trigrams[j] < a.trigrams[i]) {
+            ++j;
+        } else {
+            ++intersection;
+            ++i;
+            ++j;
+        }
+    }
+    const size_t unionSize = a.trigramCount + b.trigramCount - intersection;
+    return static_cast<float>(intersection) / static_cast<float>(unionSize);
+}
+
+int getSimilarity(const Pattern& pattern, const NormalizedText& text) {
+    const NormalizedText& patternText = pattern.getText();
+    const size_t maxLength = std::max(patternText.length, text.length);
+    if (patternText.length == 0 || text.length == 0) {
+        return 0;
+    }
+
+    const float editSimilarity = 1.0f - static_cast<float>(pattern.getEditDistance(text)) / static_cast<float>(maxLength);
+    float similarity = editSimilarity;
+
+    // Trigrams catch reordered words, which the edit distance penalizes heavily. Too short strings have none.
+    if (patternText.trigramCount > 0 && text.trigramCount > 0) {
+        similarity = std::max(similarity, getTrigramSimilarity(patternText, text));
+    }
+    return static_cast<int>(std::lround(similarity * 100.0f));
+}
+
+}// namespace AirbudsSearch::FuzzyMatch
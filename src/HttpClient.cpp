@@ -0,0 +1,252 @@
+#include <array>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include "httplib.h"
+
+#include "HttpClient.hpp"
+#include "Log.hpp"
+#include "SingleFlight.hpp"
+
+namespace AirbudsSearch::Http {
+
+/**
+ * OpenSSL can't find the Android system certificates by itself: they are stored as individual PEM files named after
+ * the old-style subject hash, which OpenSSL 3 no longer uses for directory lookups. Load them all into one store.
+ * @return The shared certificate store, or nullptr if no certificate could be loaded.
+ */
+static X509_STORE* getSystemCertificateStore() {
+    static X509_STORE* store = nullptr;
+    static std::once_flag onceFlag;
+    std::call_once(onceFlag, []() {
+        static constexpr std::array<std::string_view, 2> CERTIFICATE_DIRECTORIES{
+            "/apex/com.android.conscrypt/cacerts",
+            "/system/etc/security/cacerts",
+        };
+        X509_STORE* certificateStore = X509_STORE_new();
+        size_t certificateCount = 0;
+        for (const std::string_view directory : CERTIFICATE_DIRECTORIES) {
+            std::error_code errorCode;
+            for (const auto& entry : std::filesystem::directory_iterator(directory, errorCode)) {
+                if (!entry.is_regular_file(errorCode)) {
+                    continue;
+                }
+                FILE* file = std::fopen(entry.path().c_str(), "r");
+                if (!file) {
+                    continue;
+                }
+                X509* certificate = PEM_read_X509(file, nullptr, nullptr, nullptr);
+                std::fclose(file);
+                if (!certificate) {
+                    continue;
+                }
+                // Both directories usually contain the same certificates. Duplicates are ignored by OpenSSL.
+                if (X509_STORE_add_cert(certificateStore, certificate) == 1) {
+                    ++certificateCount;
+                }
+                X509_free(certificate);
+            }
+            if (certificateCount > 0) {
+                break;
+            }
+        }
+        AirbudsSearch::Log.info("Loaded {} system CA certificates.", certificateCount);
+        if (certificateCount == 0) {
+            X509_STORE_free(certificateStore);
+            return;
+        }
+        store = certificateStore;
+    });
+    return store;
+}
+
+// Idle connections kept per host. Searches run a few pages in parallel, so that many stay warm.
+static constexpr size_t MAX_IDLE_CLIENTS_PER_ORIGIN = 4;
+
+static std::mutex idleClientsMutex;
+static std::unordered_map<std::string, std::vector<std::unique_ptr<httplib::Client>>> idleClients;
+
+/**
+ * Takes an idle client for the origin, so the request reuses its open connection and skips the TCP and TLS
+ * handshakes. httplib reconnects by itself if the server has closed the connection in the meantime.
+ * @return A client that is used by nobody else, or nullptr if the origin is invalid.
+ */
+static std::unique_ptr<httplib::Client> acquireClient(const std::string& origin) {
+    {
+        std::lock_guard lock(idleClientsMutex);
+        const auto it = idleClients.find(origin);
+        if (it != idleClients.end() && !it->second.empty()) {
+            std::unique_ptr<httplib::Client> client = std::move(it->second.back());
+            it->second.pop_back();
+            return client;
+        }
+    }
+
+    auto client = std::make_unique<httplib::Client>(origin);
+    if (!client->is_valid()) {
+        return nullptr;
+    }
+    X509_STORE* certificateStore = getSystemCertificateStore();
+    if (certificateStore && X509_STORE_up_ref(certificateStore) == 1) {
+        // The client takes ownership of the reference
+        client->set_ca_cert_store(certificateStore);
+    }
+    client->set_follow_location(true);
+    client->set_keep_alive(true);
+    return client;
+}
+
+/**
+ * Returns a client after a completed request. Clients of failed or cancelled requests are not returned, because their
+ * connection may still have unread data on it.
+ */
+static void releaseClient(const std::string& origin, std::unique_ptr<httplib::Client> client) {
+    std::lock_guard lock(idleClientsMutex);
+    std::vector<std::unique_ptr<httplib::Client>>& clients = idleClients[origin];
+    if (clients.size() < MAX_IDLE_CLIENTS_PER_ORIGIN) {
+        clients.push_back(std::move(client));
+    }
+}
+
+/**
+ * @param send Sends the request with the given client and path. It must pass the content receiver and the progress
+ * callback on to httplib.
+ */
+template<typename Send>
+static Response performRequest(const std::string& url, const CancellationToken& cancellationToken, const std::chrono::milliseconds timeout, Send&& send) {
+    Response response;
+    if (cancellationToken.isCancelled()) {
+        response.cancelled = true;
+        return response;
+    }
+
+    // Split the URL into "scheme://host[:port]" and the path
+    const size_t schemeEnd = url.find("://");
+    const size_t pathStart = schemeEnd == std::string::npos ? std::string::npos : url.find('/', schemeEnd + 3);
+    if (schemeEnd == std::string::npos) {
+        response.error = "Invalid URL";
+        return response;
+    }
+    const std::string origin = url.substr(0, pathStart);
+    const std::string path = pathStart == std::string::npos ? "/" : url.substr(pathStart);
+
+    std::unique_ptr<httplib::Client> client = acquireClient(origin);
+    if (!client) {
+        response.error = "Invalid client";
+        return response;
+    }
+    client->set_connection_timeout(timeout);
+    client->set_read_timeout(timeout);
+
+    // Returning false from either callback makes httplib close the connection immediately
+    const httplib::Result result = send(
+        *client,
+        path,
+        [&response, &cancellationToken](const char* data, const size_t length) {
+            if (cancellationToken.isCancelled()) {
+                return false;
+            }
+            response.body.append(data, length);
+            return true;
+        },
+        [&cancellationToken](size_t, size_t) {
+            return !cancellationToken.isCancelled();
+        });
+
+    if (!result) {
+        if (result.error() == httplib::Error::Canceled || cancellationToken.isCancelled()) {
+            response.cancelled = true;
+        } else {
+            response.error = httplib::to_string(result.error());
+        }
+        return response;
+    }
+    response.httpCode = result->status;
+    for (const auto& [name, value] : result->headers) {
+        response.headers.append(name).append(": ").append(value).append("\n");
+    }
+    releaseClient(origin, std::move(client));
+    return response;
+}
+
+static Response performGet(const std::string& url, const CancellationToken& cancellationToken, const std::chrono::milliseconds timeout) {
+    const httplib::Headers headers{
+        {"User-Agent", MOD_ID "/" VERSION},
+        {"Accept", "application/json"},
+    };
+    return performRequest(url, cancellationToken, timeout, [&headers](httplib::Client& client, const std::string& path, auto&& contentReceiver, auto&& progress) {
+        return client.Get(path, headers, contentReceiver, progress);
+    });
+}
+
+static Response performPost(
+    const std::string& url,
+    const Headers& headers,
+    const std::string& body,
+    const std::string& contentType,
+    const CancellationToken& cancellationToken,
+    const std::chrono::milliseconds timeout) {
+    httplib::Headers requestHeaders(headers.begin(), headers.end());
+    if (!requestHeaders.contains("User-Agent")) {
+        requestHeaders.emplace("User-Agent", MOD_ID "/" VERSION);
+    }
+    return performRequest(url, cancellationToken, timeout, [&](httplib::Client& client, const std::string& path, auto&& contentReceiver, auto&& progress) {
+        return client.Post(path, requestHeaders, body, contentType, contentReceiver, progress);
+    });
+}
+
+/**
+ * Runs the request, sharing it with concurrent callers that use the same key.
+ */
+template<typename Perform>
+static Response runShared(SingleFlight<Response>& inFlightRequests, const std::string& key, const CancellationToken& cancellationToken, Perform&& perform) {
+    while (true) {
+        const std::optional<Response> response = inFlightRequests.run(key, cancellationToken, perform);
+        if (!response) {
+            Response cancelledResponse;
+            cancelledResponse.cancelled = true;
+            return cancelledResponse;
+        }
+
+        // The request we joined was cancelled by the caller that started it, but this caller still wants the response
+        if (response->cancelled && !cancellationToken.isCancelled()) {
+            continue;
+        }
+        return *response;
+    }
+}
+
+Response get(const std::string& url, const CancellationToken& cancellationToken, const std::chrono::milliseconds timeout) {
+    static SingleFlight<Response> inFlightRequests;
+    return runShared(inFlightRequests, url, cancellationToken, [&]() {
+        return performGet(url, cancellationToken, timeout);
+    });
+}
+
+Response post(
+    const std::string& url,
+    const Headers& headers,
+    const std::string& body,
+    const std::string& contentType,
+    const CancellationToken& cancellationToken,
+    const std::chrono::milliseconds timeout) {
+    // The headers are part of the key, so requests with different credentials are never shared
+    std::string key(url);
+    for (const auto& [name, value] : headers) {
+        key.append("\n").append(name).append(": ").append(value);
+    }
+    key.append("\n").append(contentType).append("\n\n").append(body);
+
+    static SingleFlight<Response> inFlightRequests;
+    return runShared(inFlightRequests, key, cancellationToken, [&]() {
+        return performPost(url, headers, body, contentType, cancellationToken, timeout);
+    });
+}
+
+}// namespace AirbudsSearch::Http
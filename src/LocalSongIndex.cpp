@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+#include <thread>
+
+#include "Filter.hpp"
+#include "LocalSongIndex.hpp"
+#include "Log.hpp"
+
+namespace AirbudsSearch {
+
+void LocalSongIndex::buildAsync() {
+    static std::once_flag subscribeFlag;
+    std::call_once(subscribeFlag, [this]() {
+        SongDetailsCache::SongDetails::dataAvailableEvent += [this]() {
+            rebuildAsync();
+        };
+    });
+    if (isReady_) {
+        return;
+    }
+    startBuild();
+}
+
+void LocalSongIndex::rebuildAsync() {
+    isRebuildRequested_ = true;
+    {
+        std::unique_lock lock(mutex_);
+        isReady_ = false;
+        songs_.clear();
+        postings_.clear();
+    }
+    AirbudsSearch::Log.info("SongDetails data changed, rebuilding the local song index.");
+    startBuild();
+}
+
+void LocalSongIndex::startBuild() {
+    // A build that is already running starts over by itself if a rebuild was requested
+    if (isBuilding_.exchange(true)) {
+        return;
+    }
+    std::thread([this]() {
+        while (true) {
+            isRebuildRequested_ = false;
+            SongDetailsCache::SongDetails* songDetails = SongDetailsCache::SongDetails::Init().get();
+            if (!songDetails) {
+                AirbudsSearch::Log.warn("Local song index not built: SongDetails cache is not available.");
+            } else {
+                build(*songDetails);
+            }
+            isBuilding_ = false;
+
+            // Another rebuild may have been requested right before the flag was cleared, and found it still set
+            if (!songDetails || !isRebuildRequested_ || isBuilding_.exchange(true)) {
+                return;
+            }
+        }
+    }).detach();
+}
+
+void LocalSongIndex::build(const SongDetailsCache::SongDetails& songDetails) {
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<const SongDetailsCache::Song*> songs;
+    std::unordered_map<std::string, PostingList> postings;
+    // Reused for every song, so splitting the fields doesn't allocate
+    WordList songWordList;
+    std::vector<std::string_view> songWords;
+    for (const SongDetailsCache::Song& song : songDetails.songs) {
+        const uint32_t songIndex = static_cast<uint32_t>(songs.size());
+        songs.push_back(&song);
+
+        songWordList.clear();
+        for (const std::string& field : {song.songName(), song.songAuthorName(), song.levelAuthorName()}) {
+            Filter::splitWords(field, songWordList);
+        }
+        songWords.clear();
+        for (size_t i = 0; i < songWordList.size(); ++i) {
+            songWords.push_back(songWordList[i]);
+        }
+        std::ranges::sort(songWords);
+        songWords.erase(std::unique(songWords.begin(), songWords.end()), songWords.end());
+        for (const std::string_view word : songWords) {
+            postings[std::string(word)].push_back(songIndex);
+        }
+    }
+    for (auto& [word, postingList] : postings) {
+        postingList.shrink_to_fit();
+    }
+
+    const size_t songCount = songs.size();
+    const size_t wordCount = postings.size();
+    {
+        std::unique_lock lock(mutex_);
+
+        // The songs were replaced while building, so these pointers may already be dangling
+        if (isRebuildRequested_) {
+            return;
+        }
+        songs_ = std::move(songs);
+        postings_ = std::move(postings);
+        isReady_ = true;
+    }
+
+    AirbudsSearch::Log.info(
+        "Local song index built: songs = {} words = {} time = {} ms.",
+        songCount,
+        wordCount,
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime).count());
+}
+
+std::vector<const SongDetailsCache::Song*> LocalSongIndex::search(const std::string& query, const size_t limit) const {
+    std::vector<const SongDetailsCache::Song*> results;
+    if (!isReady_ || limit == 0) {
+        return results;
+    }
+
+    WordList wordList;
+    Filter::splitWords(query, wordList);
+    std::vector<std::string_view> words;
+    words.reserve(wordList.size());
+    for (size_t i = 0; i < wordList.size(); ++i) {
+        words.push_back(wordList[i]);
+    }
+    std::ranges::sort(words);
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    if (words.empty()) {
+        return results;
+    }
+
+    std::shared_lock lock(mutex_);
+
+    // Count how many of the query words each song contains
+    std::unordered_map<uint32_t, uint32_t> matchCounts;
+    for (const std::string_view word : words) {
+        const auto it = postings_.find(std::string(word));
+        if (it == postings_.end()) {
+            continue;
+        }
+        for (const uint32_t songIndex : it->second) {
+            ++matchCounts[songIndex];
+        }
+    }
+
+    // Require at least half of the words to match. Otherwise common words like "the" would match most of the cache.
+    const uint32_t minimumMatchCount = static_cast<uint32_t>((words.size() + 1) / 2);
+    struct Match {
+        uint32_t songIndex;
+        uint32_t matchCount;
+        uint32_t upvotes;
+    };
+    std::vector<Match> matches;
+    for (const auto& [songIndex, matchCount] : matchCounts) {
+        if (matchCount >= minimumMatchCount) {
+            matches.push_back({songIndex, matchCount, songs_[songIndex]->upvotes});
+        }
+    }
+
+    const auto isBetterMatch = [](const Match& a, const Match& b) {
+        if (a.matchCount != b.matchCount) {
+            return a.matchCount > b.matchCount;
+        }
+        if (a.upvotes != b.upvotes) {
+            return a.upvotes > b.upvotes;
+        }
+        return a.songIndex < b.songIndex;
+    };
+    const size_t count = std::min(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), isBetterMatch);
+
+    results.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        results.push_back(songs_[matches[i].songIndex]);
+    }
+    return results;
+}
+
+}// namespace AirbudsSearch
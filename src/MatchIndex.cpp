@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+#include "songcore/shared/SongCore.hpp"
+#include "web-utils/shared/WebUtils.hpp" // For rapidjson
+
+#include "Configuration.hpp"
+#include "FileUtils.hpp"
+#include "Filter.hpp"
+#include "Log.hpp"
+#include "MatchIndex.hpp"
+#include "SearchPrefetcher.hpp"
+#include "SongDetailsMatching.hpp"
+
+namespace AirbudsSearch {
+
+// The index is a single JSON file:
+// { "version": 1, "tracks": { "<track id>": { "scoringVersion": 1, "updatedAt": <seconds>, "partial": false, "matches": [ { "hash": "...", "score": 0, "rank": 0 } ] } } }
+
+static int64_t getCurrentTimestamp() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::filesystem::path MatchIndex::getPath() {
+    return AirbudsSearch::getDataDirectory() / "match_index.json";
+}
+
+void MatchIndex::load() {
+    if (isLoaded_) {
+        return;
+    }
+    isLoaded_ = true;
+
+    const std::filesystem::path path = getPath();
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.empty()) {
+        return;
+    }
+
+    rapidjson::Document document;
+    document.Parse(data.c_str());
+    if (!document.IsObject() || !document.HasMember("tracks") || !document["tracks"].IsObject()) {
+        AirbudsSearch::Log.warn("Match index is invalid: {}", path.string());
+        return;
+    }
+
+    for (const auto& member : document["tracks"].GetObject()) {
+        const auto& item = member.value;
+        if (!item.IsObject() || !item.HasMember("matches") || !item["matches"].IsArray()) {
+            continue;
+        }
+        Entry entry;
+        if (item.HasMember("scoringVersion") && item["scoringVersion"].IsInt()) {
+            entry.scoringVersion = item["scoringVersion"].GetInt();
+        }
+        if (item.HasMember("updatedAt") && item["updatedAt"].IsInt64()) {
+            entry.updatedAt = item["updatedAt"].GetInt64();
+        }
+        if (item.HasMember("partial") && item["partial"].IsBool()) {
+            entry.isPartial = item["partial"].GetBool();
+        }
+        for (const auto& matchJson : item["matches"].GetArray()) {
+            if (!matchJson.IsObject() || !matchJson.HasMember("hash") || !matchJson["hash"].IsString()) {
+                continue;
+            }
+            StoredMatch match;
+            match.hash = matchJson["hash"].GetString();
+            if (matchJson.HasMember("score") && matchJson["score"].IsInt()) {
+                match.score = matchJson["score"].GetInt();
+            }
+            if (matchJson.HasMember("rank") && matchJson["rank"].IsInt()) {
+                match.rank = matchJson["rank"].GetInt();
+            }
+            entry.matches.push_back(std::move(match));
+        }
+        entries_.emplace(member.name.GetString(), std::move(entry));
+    }
+    AirbudsSearch::Log.info("Loaded match index: tracks = {}", entries_.size());
+}
+
+void MatchIndex::save() {
+    std::lock_guard fileLock(fileMutex_);
+    rapidjson::StringBuffer buffer;
+    {
+        std::lock_guard lock(mutex_);
+        if (!isDirty_) {
+            return;
+        }
+        isDirty_ = false;
+
+        rapidjson::Document document;
+        document.SetObject();
+        auto& allocator = document.GetAllocator();
+        document.AddMember("version", 1, allocator);
+
+        rapidjson::Value tracks(rapidjson::kObjectType);
+        for (const auto& [trackId, entry] : entries_) {
+            rapidjson::Value item(rapidjson::kObjectType);
+            item.AddMember("scoringVersion", entry.scoringVersion, allocator);
+            item.AddMember("updatedAt", entry.updatedAt, allocator);
+            if (entry.isPartial) {
+                item.AddMember("partial", true, allocator);
+            }
+            rapidjson::Value matches(rapidjson::kArrayType);
+            for (const StoredMatch& match : entry.matches) {
+                rapidjson::Value matchJson(rapidjson::kObjectType);
+                matchJson.AddMember("hash", rapidjson::Value(match.hash.c_str(), allocator), allocator);
+                matchJson.AddMember("score", match.score, allocator);
+                matchJson.AddMember("rank", match.rank, allocator);
+                matches.PushBack(matchJson, allocator);
+            }
+            item.AddMember("matches", matches, allocator);
+            tracks.AddMember(rapidjson::Value(trackId.c_str(), allocator), item, allocator);
+        }
+        document.AddMember("tracks", tracks, allocator);
+
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        document.Accept(writer);
+    }
+
+    if (!Utils::writeFileAtomically(getPath(), std::string_view(buffer.GetString(), buffer.GetSize()))) {
+        // Try again on the next save
+        std::lock_guard lock(mutex_);
+        isDirty_ = true;
+    }
+}
+
+std::optional<MatchIndex::Entry> MatchIndex::get(const std::string& trackId) {
+    std::lock_guard lock(mutex_);
+    load();
+    const auto it = entries_.find(trackId);
+    if (it == entries_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+bool MatchIndex::isStale(const Entry& entry) {
+    if (entry.isPartial || entry.scoringVersion != SCORING_VERSION) {
+        return true;
+    }
+    const auto age = std::chrono::seconds(getCurrentTimestamp() - entry.updatedAt);
+    return age > getMatchIndexTtl();
+}
+
+void MatchIndex::put(const std::string& trackId, const TrackMatcher::Result& result) {
+    Entry entry;
+    entry.scoringVersion = SCORING_VERSION;
+    entry.updatedAt = getCurrentTimestamp();
+    entry.isPartial = result.hadAnyFailure;
+    const size_t count = std::min(result.matches.size(), MAX_MATCHES);
+    entry.matches.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const TrackMatcher::Match& match = result.matches[i];
+        entry.matches.push_back(StoredMatch{match.song->hash(), match.score, match.rank});
+    }
+
+    std::lock_guard lock(mutex_);
+    load();
+    entries_.insert_or_assign(trackId, std::move(entry));
+    while (entries_.size() > MAX_ENTRIES) {
+        const auto oldest = std::min_element(entries_.begin(), entries_.end(), [](const auto& left, const auto& right) {
+            return left.second.updatedAt < right.second.updatedAt;
+        });
+        entries_.erase(oldest);
+    }
+    isDirty_ = true;
+}
+
+void MatchIndex::indexTracksAsync(const std::vector<airbuds::PlaylistTrack>& tracks) {
+    std::vector<airbuds::Track> tracksToIndex;
+    {
+        std::lock_guard lock(mutex_);
+        load();
+        for (const airbuds::PlaylistTrack& track : tracks) {
+            const auto it = entries_.find(track.id);
+            if (it == entries_.end() || isStale(it->second)) {
+                tracksToIndex.push_back(track);
+            }
+        }
+    }
+    if (tracksToIndex.empty()) {
+        return;
+    }
+    AirbudsSearch::Log.info("Queued tracks for the match index: {}", tracksToIndex.size());
+    SearchPrefetcher::getInstance().addIndexTracks(std::move(tracksToIndex));
+}
+
+std::vector<const SongDetailsCache::Song*> MatchIndex::resolve(const Entry& entry, const TrackMatcher::Options& options) {
+    std::vector<const SongDetailsCache::Song*> songs;
+    SongDetailsCache::SongDetails* songDetails = SongDetailsCache::SongDetails::Init().get();
+    if (!songDetails) {
+        return songs;
+    }
+
+    // The stored scores don't include the difficulty bonus, so add it back for the current filter
+    std::vector<TrackMatcher::Match> matches;
+    matches.reserve(entry.matches.size());
+    for (const StoredMatch& storedMatch : entry.matches) {
+        const SongDetailsCache::Song* song = nullptr;
+        if (!songDetails->songs.FindByHash(storedMatch.hash, song) || !song) {
+            continue;
+        }
+        if (!options.includeDownloadedSongs && SongCore::API::Loading::GetLevelByHash(storedMatch.hash)) {
+            continue;
+        }
+        int score = storedMatch.score;
+        if (Filter::songHasDifficulty(*song, options.difficulties)) {
+            score += Filter::DIFFICULTY_BONUS;
+        }
+        matches.push_back(TrackMatcher::Match{song, score, storedMatch.rank});
+    }
+    std::stable_sort(matches.begin(), matches.end(), TrackMatcher::isBetterMatch);
+
+    songs.reserve(matches.size());
+    for (const TrackMatcher::Match& match : matches) {
+        songs.push_back(match.song);
+    }
+    return songs;
+}
+
+}// namespace AirbudsSearch
@@ -0,0 +1,398 @@
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "Normalization.hpp"
+#include "Utf8.hpp"
+
+namespace AirbudsSearch::Normalization {
+
+// Base letter of every Latin-1 Supplement, Latin Extended-A and Latin Extended-B letter (U+00C0 - U+024F), one row per
+// 16 code points, generated from the character names. '.' marks characters that are kept as they are, '+' the
+// ligatures and digraphs in LATIN_EXPANSIONS and '*' the letters without a base letter that are only lowercased, with
+// their simple case folding from LATIN_CASE_FOLDS.
+static constexpr std::string_view LATIN_BASE_LETTERS =
+    "aaaaaa+ceeeeiiii"
+    "dnooooo.ouuuuy*+"
+    "aaaaaa+ceeeeiiii"
+    "dnooooo.ouuuuy.y"
+    "aaaaaaccccccccdd"
+    "ddeeeeeeeeeegggg"
+    "gggghhhhiiiiiiii"
+    "ii++jjkk.lllllll"
+    "lllnnnnnn.*.oooo"
+    "oo++rrrrrrssssss"
+    "ssttttttuuuuuuuu"
+    "uuuuwwyyyzzzzzzs"
+    "bbbb*.*ccdddd.**"
+    "*ffg*+*ikkl.*nn*"
+    "oo++pp**.*.ttttu"
+    "u*vyyzz**...*..."
+    "....+++++++++aai"
+    "ioouuuuuuuuuu.aa"
+    "aa++ggggkkoooo*."
+    "j+++gg+*nnaa++oo"
+    "aaaaeeeeiiiioooo"
+    "rrrruuuusstt*.hh"
+    "nd++zzaaeeoooooo"
+    "ooyylnt.++acclts"
+    "z*.b**eejjqqrryy";
+
+static constexpr uint32_t LATIN_FIRST = 0x00C0;
+
+static_assert(LATIN_BASE_LETTERS.size() == 0x0250 - LATIN_FIRST);
+
+// The same for Latin Extended Additional (U+1E00 - U+1EFF)
+static constexpr std::string_view LATIN_ADDITIONAL_BASE_LETTERS =
+    "aabbbbbbccdddddd"
+    "ddddeeeeeeeeeeff"
+    "gghhhhhhhhhhiiii"
+    "kkkkkkllllllllmm"
+    "mmmmnnnnnnnnoooo"
+    "oooopppprrrrrrrr"
+    "sssssssssstttttt"
+    "ttuuuuuuuuuuvvvv"
+    "wwwwwwwwwwxxxxyy"
+    "zzzzzzhtwyasss+."
+    "aaaaaaaaaaaaaaaa"
+    "aaaaaaaaeeeeeeee"
+    "eeeeeeeeiiiioooo"
+    "oooooooooooooooo"
+    "oooouuuuuuuuuuuu"
+    "uuyyyyyyyy++*.yy";
+
+static constexpr uint32_t LATIN_ADDITIONAL_FIRST = 0x1E00;
+
+static_assert(LATIN_ADDITIONAL_BASE_LETTERS.size() == 0x0100);
+
+struct Expansion {
+    uint32_t codepoint;
+    std::string_view letters;
+};
+
+static constexpr std::array<Expansion, 34> LATIN_EXPANSIONS = {{
+    {0x00C6, "ae"},
+    {0x00DF, "ss"},
+    {0x00E6, "ae"},
+    {0x0132, "ij"},
+    {0x0133, "ij"},
+    {0x0152, "oe"},
+    {0x0153, "oe"},
+    {0x0195, "hv"},
+    {0x01A2, "oi"},
+    {0x01A3, "oi"},
+    {0x01C4, "dz"},
+    {0x01C5, "dz"},
+    {0x01C6, "dz"},
+    {0x01C7, "lj"},
+    {0x01C8, "lj"},
+    {0x01C9, "lj"},
+    {0x01CA, "nj"},
+    {0x01CB, "nj"},
+    {0x01CC, "nj"},
+    {0x01E2, "ae"},
+    {0x01E3, "ae"},
+    {0x01F1, "dz"},
+    {0x01F2, "dz"},
+    {0x01F3, "dz"},
+    {0x01F6, "hv"},
+    {0x01FC, "ae"},
+    {0x01FD, "ae"},
+    {0x0222, "ou"},
+    {0x0223, "ou"},
+    {0x0238, "db"},
+    {0x0239, "qp"},
+    {0x1E9E, "ss"},
+    {0x1EFA, "ll"},
+    {0x1EFB, "ll"},
+}};
+
+struct CaseFold {
+    uint32_t codepoint;
+    uint32_t folded;
+};
+
+// Simple case folding (CaseFolding.txt, status C and S) of the letters marked '*'. None of them is folded to a longer
+// UTF-8 sequence, the lowercase forms of Latin Extended-B are in IPA Extensions (U+0250 - U+02AF) or Latin Extended-B.
+static constexpr std::array<CaseFold, 25> LATIN_CASE_FOLDS = {{
+    {0x00DE, 0x00FE},
+    {0x014A, 0x014B},
+    {0x0184, 0x0185},
+    {0x0186, 0x0254},
+    {0x018E, 0x01DD},
+    {0x018F, 0x0259},
+    {0x0190, 0x025B},
+    {0x0194, 0x0263},
+    {0x0196, 0x0269},
+    {0x019C, 0x026F},
+    {0x019F, 0x0275},
+    {0x01A6, 0x0280},
+    {0x01A7, 0x01A8},
+    {0x01A9, 0x0283},
+    {0x01B1, 0x028A},
+    {0x01B7, 0x0292},
+    {0x01B8, 0x01B9},
+    {0x01BC, 0x01BD},
+    {0x01EE, 0x01EF},
+    {0x01F7, 0x01BF},
+    {0x021C, 0x021D},
+    {0x0241, 0x0242},
+    {0x0244, 0x0289},
+    {0x0245, 0x028C},
+    {0x1EFC, 0x1EFD},
+}};
+
+// Case folding and accent stripping for Greek, Cyrillic and Armenian, generated from the layout of the blocks
+static constexpr uint32_t ALPHABETS_FIRST = 0x0370;
+static constexpr uint32_t ALPHABETS_END = 0x0590;
+
+static constexpr std::array<uint16_t, ALPHABETS_END - ALPHABETS_FIRST> ALPHABETS_FOLDING_TABLE = []() {
+    std::array<uint16_t, ALPHABETS_END - ALPHABETS_FIRST> table{};
+    const auto set = [&table](const uint32_t codepoint, const uint32_t folded) {
+        table[codepoint - ALPHABETS_FIRST] = static_cast<uint16_t>(folded);
+    };
+    const auto get = [&table](const uint32_t codepoint) {
+        return static_cast<uint32_t>(table[codepoint - ALPHABETS_FIRST]);
+    };
+    for (uint32_t codepoint = ALPHABETS_FIRST; codepoint < ALPHABETS_END; ++codepoint) {
+        set(codepoint, codepoint);
+    }
+    const auto foldPairs = [&set](const uint32_t first, const uint32_t last) {
+        for (uint32_t codepoint = first; codepoint < last; codepoint += 2) {
+            set(codepoint, codepoint + 1);
+        }
+    };
+
+    // Greek: accented letters first, so the capitals below fold straight to the unaccented lowercase letter
+    for (const auto [accented, base] : std::array<std::array<uint32_t, 2>, 11>{{
+             {0x03AC, 0x03B1},
+             {0x03AD, 0x03B5},
+             {0x03AE, 0x03B7},
+             {0x03AF, 0x03B9},
+             {0x0390, 0x03B9},
+             {0x03CA, 0x03B9},
+             {0x03CC, 0x03BF},
+             {0x03CD, 0x03C5},
+             {0x03B0, 0x03C5},
+             {0x03CB, 0x03C5},
+             {0x03CE, 0x03C9},
+         }}) {
+        set(accented, base);
+    }
+    for (uint32_t codepoint = 0x0391; codepoint <= 0x03AB; ++codepoint) {
+        if (codepoint != 0x03A2) {
+            set(codepoint, get(codepoint + 0x20));
+        }
+    }
+    set(0x0386, 0x03B1);
+    set(0x0388, 0x03B5);
+    set(0x0389, 0x03B7);
+    set(0x038A, 0x03B9);
+    set(0x038C, 0x03BF);
+    set(0x038E, 0x03C5);
+    set(0x038F, 0x03C9);
+    set(0x03C2, 0x03C3);
+    set(0x03D0, 0x03B2);
+    set(0x03D1, 0x03B8);
+    set(0x03D5, 0x03C6);
+    set(0x03D6, 0x03C0);
+    set(0x03F0, 0x03BA);
+    set(0x03F1, 0x03C1);
+    set(0x03F5, 0x03B5);
+    foldPairs(0x03D8, 0x03F0);
+
+    // Cyrillic. "ё" is usually written as "е", so they compare equal.
+    set(0x0450, 0x0435);
+    set(0x0451, 0x0435);
+    set(0x045D, 0x0438);
+    for (uint32_t codepoint = 0x0400; codepoint <= 0x040F; ++codepoint) {
+        set(codepoint, get(codepoint + 0x50));
+    }
+    for (uint32_t codepoint = 0x0410; codepoint <= 0x042F; ++codepoint) {
+        set(codepoint, codepoint + 0x20);
+    }
+    foldPairs(0x0460, 0x0482);
+    foldPairs(0x048A, 0x04C0);
+    set(0x04C0, 0x04CF);
+    foldPairs(0x04C1, 0x04CF);
+    foldPairs(0x04D0, 0x0500);
+    foldPairs(0x0500, 0x0530);
+
+    // Armenian
+    for (uint32_t codepoint = 0x0531; codepoint <= 0x0556; ++codepoint) {
+        set(codepoint, codepoint + 0x30);
+    }
+    return table;
+}();
+
+// Half-width katakana and punctuation (U+FF61 - U+FF9F) in their normal width
+static constexpr uint32_t HALF_WIDTH_FIRST = 0xFF61;
+
+static constexpr std::array<uint16_t, 0xFFA0 - HALF_WIDTH_FIRST> HALF_WIDTH_KATAKANA = {
+    0x3002, 0x300C, 0x300D, 0x3001, 0x30FB, 0x30F2, 0x30A1, 0x30A3, 0x30A5, 0x30A7, 0x30A9, 0x30E3, 0x30E5, 0x30E7, 0x30C3,
+    0x30FC, 0x30A2, 0x30A4, 0x30A6, 0x30A8, 0x30AA, 0x30AB, 0x30AD, 0x30AF, 0x30B1, 0x30B3, 0x30B5, 0x30B7, 0x30B9, 0x30BB,
+    0x30BD, 0x30BF, 0x30C1, 0x30C4, 0x30C6, 0x30C8, 0x30CA, 0x30CB, 0x30CC, 0x30CD, 0x30CE, 0x30CF, 0x30D2, 0x30D5, 0x30D8,
+    0x30DB, 0x30DE, 0x30DF, 0x30E0, 0x30E1, 0x30E2, 0x30E4, 0x30E6, 0x30E8, 0x30E9, 0x30EA, 0x30EB, 0x30EC, 0x30ED, 0x30EF,
+    0x30F3, 0x3099, 0x309A,
+};
+
+// Which hiragana (U+3040 - U+309F) take the voiced (bit 0) and semi-voiced (bit 1) sound marks
+static constexpr uint32_t HIRAGANA_FIRST = 0x3040;
+static constexpr uint8_t VOICED = 1;
+static constexpr uint8_t SEMI_VOICED = 2;
+
+static constexpr std::array<uint8_t, 0x60> HIRAGANA_SOUND_MARKS = []() {
+    std::array<uint8_t, 0x60> table{};
+    // か to ぢ alternate with their voiced form
+    for (uint32_t codepoint = 0x304B; codepoint <= 0x3061; codepoint += 2) {
+        table[codepoint - HIRAGANA_FIRST] = VOICED;
+    }
+    // つ, て and と, after the small っ
+    for (uint32_t codepoint = 0x3064; codepoint <= 0x3068; codepoint += 2) {
+        table[codepoint - HIRAGANA_FIRST] = VOICED;
+    }
+    // は to ほ come in threes
+    for (uint32_t codepoint = 0x306F; codepoint <= 0x307B; codepoint += 3) {
+        table[codepoint - HIRAGANA_FIRST] = VOICED | SEMI_VOICED;
+    }
+    table[0x3046 - HIRAGANA_FIRST] = VOICED;
+    table[0x309D - HIRAGANA_FIRST] = VOICED;
+    return table;
+}();
+
+static uint32_t getVoicedKana(const uint32_t kana, const bool isSemiVoiced) {
+    const uint8_t soundMarks = HIRAGANA_SOUND_MARKS[kana - HIRAGANA_FIRST];
+    if (isSemiVoiced) {
+        return (soundMarks & SEMI_VOICED) != 0 ? kana + 2 : 0;
+    }
+    if ((soundMarks & VOICED) == 0) {
+        return 0;
+    }
+    // う becomes ゔ, out of order
+    return kana == 0x3046 ? 0x3094 : kana + 1;
+}
+
+static bool isHiragana(const uint32_t codepoint) {
+    return codepoint >= HIRAGANA_FIRST && codepoint < HIRAGANA_FIRST + 0x60;
+}
+
+size_t foldForMatching(const std::string_view text, char* const output) {
+    size_t length = 0;
+
+    // Where the last hiragana starts in the output, so a separate sound mark after it can be merged into it
+    size_t lastKanaOffset = 0;
+    uint32_t lastKana = 0;
+
+    const auto append = [&](const uint32_t codepoint) {
+        std::array<char, 4> encoded{};
+        const size_t encodedLength = Utf8::encodeCodepoint(codepoint, encoded);
+        if (isHiragana(codepoint)) {
+            lastKanaOffset = length;
+            lastKana = codepoint;
+        } else {
+            lastKana = 0;
+        }
+        for (size_t j = 0; j < encodedLength; ++j) {
+            output[length++] = encoded[j];
+        }
+    };
+
+    const auto appendLatin = [&](const uint32_t codepoint, const char baseLetter) {
+        if (baseLetter == '+') {
+            for (const Expansion& expansion : LATIN_EXPANSIONS) {
+                if (expansion.codepoint == codepoint) {
+                    for (const char letter : expansion.letters) {
+                        append(static_cast<unsigned char>(letter));
+                    }
+                    return;
+                }
+            }
+        } else if (baseLetter == '*') {
+            for (const CaseFold& caseFold : LATIN_CASE_FOLDS) {
+                if (caseFold.codepoint == codepoint) {
+                    append(caseFold.folded);
+                    return;
+                }
+            }
+        } else if (baseLetter != '.') {
+            append(static_cast<unsigned char>(baseLetter));
+            return;
+        }
+        append(codepoint);
+    };
+
+    for (size_t i = 0; i < text.size();) {
+        const size_t asciiEnd = i + Utf8::countAsciiPrefix(text.substr(i));
+        if (asciiEnd > i) {
+            for (; i < asciiEnd; ++i) {
+                const char c = text[i];
+                output[length++] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+            }
+            lastKana = 0;
+            continue;
+        }
+
+        uint32_t codepoint = 0;
+        const size_t sequenceLength = Utf8::decodeCodepoint(text, i, codepoint);
+        if (sequenceLength == 0) {
+            output[length++] = text[i++];
+            lastKana = 0;
+            continue;
+        }
+        i += sequenceLength;
+
+        if (codepoint >= LATIN_FIRST && codepoint < LATIN_FIRST + LATIN_BASE_LETTERS.size()) {
+            appendLatin(codepoint, LATIN_BASE_LETTERS[codepoint - LATIN_FIRST]);
+            continue;
+        }
+        if (codepoint >= LATIN_ADDITIONAL_FIRST
+            && codepoint < LATIN_ADDITIONAL_FIRST + LATIN_ADDITIONAL_BASE_LETTERS.size()) {
+            appendLatin(codepoint, LATIN_ADDITIONAL_BASE_LETTERS[codepoint - LATIN_ADDITIONAL_FIRST]);
+            continue;
+        }
+        if (codepoint == 0x00B5) {
+            // Micro sign
+            append(0x03BC);
+            continue;
+        }
+        if (codepoint >= 0x0300 && codepoint <= 0x036F) {
+            // Combining diacritics
+            continue;
+        }
+        if (codepoint >= ALPHABETS_FIRST && codepoint < ALPHABETS_END) {
+            append(ALPHABETS_FOLDING_TABLE[codepoint - ALPHABETS_FIRST]);
+            continue;
+        }
+        if (codepoint == 0x3000) {
+            // Ideographic space
+            append(' ');
+            continue;
+        }
+        if (codepoint >= 0xFF01 && codepoint <= 0xFF5E) {
+            // Full-width ASCII
+            const char c = static_cast<char>(codepoint - 0xFEE0);
+            append(static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c));
+            continue;
+        }
+        if (codepoint >= HALF_WIDTH_FIRST && codepoint < HALF_WIDTH_FIRST + HALF_WIDTH_KATAKANA.size()) {
+            codepoint = HALF_WIDTH_KATAKANA[codepoint - HALF_WIDTH_FIRST];
+        }
+        if ((codepoint >= 0x30A1 && codepoint <= 0x30F6) || codepoint == 0x30FD || codepoint == 0x30FE) {
+            // Katakana to hiragana
+            codepoint -= 0x60;
+        }
+        if (codepoint >= 0x3099 && codepoint <= 0x309C && lastKana != 0) {
+            // Combining and spacing sound marks
+            const uint32_t voicedKana = getVoicedKana(lastKana, codepoint == 0x309A || codepoint == 0x309C);
+            if (voicedKana != 0) {
+                length = lastKanaOffset;
+                append(voicedKana);
+                continue;
+            }
+        }
+        append(codepoint);
+    }
+    return length;
+}
+
+}// namespace AirbudsSearch::Normalization
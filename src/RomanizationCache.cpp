@@ -0,0 +1,179 @@
+#include <cstring>
+#include <fstream>
+
+#ifdef QUEST
+#include "Configuration.hpp"
+#endif
+
+#include "FileUtils.hpp"
+#include "Log.hpp"
+#include "RomanizationCache.hpp"
+
+namespace AirbudsSearch {
+
+// The cache file is binary, in native byte order:
+// "ABRC" <format version: u32> <romanization version: u64> <entry count: u32>
+// then per entry, most recently used first: <text length: u32> <text> <romaji length: u32> <romaji>
+static constexpr char FILE_MAGIC[4] = {'A', 'B', 'R', 'C'};
+static constexpr uint32_t FILE_FORMAT_VERSION = 1;
+
+template <typename T>
+static void appendValue(std::string& buffer, const T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool readValue(std::string_view& data, T& value) {
+    if (data.size() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, data.data(), sizeof(value));
+    data.remove_prefix(sizeof(value));
+    return true;
+}
+
+static bool readString(std::string_view& data, std::string& value) {
+    uint32_t length = 0;
+    if (!readValue(data, length) || data.size() < length) {
+        return false;
+    }
+    value.assign(data.data(), length);
+    data.remove_prefix(length);
+    return true;
+}
+
+std::filesystem::path RomanizationCache::getPath() {
+#ifdef QUEST
+    return AirbudsSearch::getDataDirectory() / "romanization_cache.bin";
+#else
+    // Desktop builds have no mod data directory
+    return std::filesystem::current_path() / "romanization_cache.bin";
+#endif
+}
+
+void RomanizationCache::load(const uint64_t version) {
+    isLoaded_ = true;
+
+    const std::filesystem::path path = getPath();
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::string_view data = contents;
+
+    uint32_t formatVersion = 0;
+    uint64_t fileVersion = 0;
+    uint32_t count = 0;
+    if (data.size() < sizeof(FILE_MAGIC) || std::memcmp(data.data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+        AirbudsSearch::Log.warn("Ignoring invalid romanization cache: {}", path.string());
+        return;
+    }
+    data.remove_prefix(sizeof(FILE_MAGIC));
+    if (!readValue(data, formatVersion) || !readValue(data, fileVersion) || !readValue(data, count)) {
+        AirbudsSearch::Log.warn("Ignoring invalid romanization cache: {}", path.string());
+        return;
+    }
+    if (formatVersion != FILE_FORMAT_VERSION || fileVersion != version) {
+        // Made with other overrides or another converter. Overwritten on the next save.
+        AirbudsSearch::Log.info("Discarding romanization cache from another version");
+        isDirty_ = true;
+        return;
+    }
+
+    for (uint32_t i = 0; i < count && entries_.size() < MAX_ENTRIES; ++i) {
+        Entry entry;
+        if (!readString(data, entry.text) || !readString(data, entry.romaji)) {
+            AirbudsSearch::Log.warn("Romanization cache is truncated: {}", path.string());
+            break;
+        }
+        if (index_.contains(entry.text)) {
+            continue;
+        }
+        entries_.push_back(std::move(entry));
+        index_.emplace(entries_.back().text, std::prev(entries_.end()));
+    }
+    AirbudsSearch::Log.info("Loaded romanization cache: entries = {}", entries_.size());
+}
+
+void RomanizationCache::setVersion(const uint64_t version) {
+    if (!isLoaded_) {
+        version_ = version;
+        load(version);
+        return;
+    }
+    if (version == version_) {
+        return;
+    }
+    version_ = version;
+    index_.clear();
+    entries_.clear();
+    isDirty_ = true;
+}
+
+std::optional<std::string> RomanizationCache::get(const std::string& text, const uint64_t version) {
+    std::lock_guard lock(mutex_);
+    setVersion(version);
+    const auto it = index_.find(text);
+    if (it == index_.end()) {
+        return std::nullopt;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->romaji;
+}
+
+void RomanizationCache::put(const std::string& text, const std::string& romaji, const uint64_t version) {
+    std::lock_guard lock(mutex_);
+    setVersion(version);
+
+    // Another thread may have romanized the same text in the meantime
+    const auto it = index_.find(text);
+    if (it != index_.end()) {
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+
+    entries_.push_front(Entry{text, romaji});
+    index_.emplace(entries_.front().text, entries_.begin());
+    if (entries_.size() > MAX_ENTRIES) {
+        index_.erase(entries_.back().text);
+        entries_.pop_back();
+    }
+    isDirty_ = true;
+}
+
+void RomanizationCache::save() {
+    std::lock_guard fileLock(fileMutex_);
+    std::string buffer;
+    {
+        std::lock_guard lock(mutex_);
+        if (!isLoaded_ || !isDirty_) {
+            return;
+        }
+        isDirty_ = false;
+
+        size_t size = sizeof(FILE_MAGIC) + sizeof(FILE_FORMAT_VERSION) + sizeof(version_) + sizeof(uint32_t);
+        for (const Entry& entry : entries_) {
+            size += sizeof(uint32_t) * 2 + entry.text.size() + entry.romaji.size();
+        }
+        buffer.reserve(size);
+        buffer.append(FILE_MAGIC, sizeof(FILE_MAGIC));
+        appendValue(buffer, FILE_FORMAT_VERSION);
+        appendValue(buffer, version_);
+        appendValue(buffer, static_cast<uint32_t>(entries_.size()));
+        for (const Entry& entry : entries_) {
+            appendValue(buffer, static_cast<uint32_t>(entry.text.size()));
+            buffer.append(entry.text);
+            appendValue(buffer, static_cast<uint32_t>(entry.romaji.size()));
+            buffer.append(entry.romaji);
+        }
+    }
+
+    if (!Utils::writeFileAtomically(getPath(), buffer)) {
+        // Try again on the next save
+        std::lock_guard lock(mutex_);
+        isDirty_ = true;
+    }
+}
+
+}// namespace AirbudsSearch
@@ -0,0 +1,46 @@
+#include "ScoringPipeline.hpp"
+
+namespace AirbudsSearch::Scoring {
+
+CandidateBatch::CandidateBatch(const Filter::TrackMatchInfo& trackInfo) : isRomanizingNames_(!trackInfo.romaji.empty()) {}
+
+void CandidateBatch::reserve(const size_t count) {
+    songNameTokens.reserve(count);
+    mapNameTokens.reserve(count);
+    songNameRomajiTokens.reserve(count);
+    songNameTexts.reserve(count);
+    mapNameTexts.reserve(count);
+    songNameRomajiTexts.reserve(count);
+    songAuthorTokens.reserve(count);
+    levelAuthorTokens.reserve(count);
+    ratings.reserve(count);
+    hasPreferredDifficulty.reserve(count);
+}
+
+void CandidateBatch::addSearchCandidate(const BeatSaverSearch::SearchCandidate& candidate, const bool hasDifficulty) {
+    add(candidate.songName, candidate.name, candidate.songAuthorName, candidate.levelAuthorName, candidate.score, hasDifficulty);
+}
+
+void CandidateBatch::add(
+    const std::string& songName,
+    const std::string& mapName,
+    const std::string& songAuthor,
+    const std::string& levelAuthor,
+    const float rating,
+    const bool hasDifficulty) {
+    songNameTokens.push_back(Filter::tokenize(songName));
+    songNameTexts.push_back(FuzzyMatch::normalize(songName));
+    mapNameTokens.push_back(Filter::tokenize(mapName));
+    mapNameTexts.push_back(FuzzyMatch::normalize(mapName));
+
+    const std::string songNameRomaji = isRomanizingNames_ ? Filter::romanizeJapanese(songName) : std::string();
+    songNameRomajiTokens.push_back(Filter::tokenize(songNameRomaji));
+    songNameRomajiTexts.push_back(FuzzyMatch::normalize(songNameRomaji));
+
+    songAuthorTokens.push_back(Filter::tokenize(songAuthor));
+    levelAuthorTokens.push_back(Filter::tokenize(levelAuthor));
+    ratings.push_back(rating);
+    hasPreferredDifficulty.push_back(hasDifficulty ? 1 : 0);
+}
+
+}// namespace AirbudsSearch::Scoring
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <thread>
+
+#include <sys/resource.h>
+
+#include "BeatSaverSearch.hpp"
+#include "Configuration.hpp"
+#include "Filter.hpp"
+#include "Log.hpp"
+#include "MatchIndex.hpp"
+#include "RomanizationCache.hpp"
+#include "SearchPrefetcher.hpp"
+#include "TrackMatcher.hpp"
+
+namespace AirbudsSearch {
+
+// The match index is written to disk after this many new entries, and when the queue is empty
+static constexpr size_t INDEX_SAVE_INTERVAL = 10;
+
+void SearchPrefetcher::setTracks(std::vector<airbuds::Track> tracks) {
+    std::lock_guard lock(mutex_);
+    pendingTracks_.assign(std::make_move_iterator(tracks.begin()), std::make_move_iterator(tracks.end()));
+    startThreadIfNeeded();
+    conditionVariable_.notify_all();
+}
+
+void SearchPrefetcher::addIndexTracks(std::vector<airbuds::Track> tracks) {
+    std::lock_guard lock(mutex_);
+    for (airbuds::Track& track : tracks) {
+        if (std::find(pendingIndexTracks_.begin(), pendingIndexTracks_.end(), track) == pendingIndexTracks_.end()) {
+            pendingIndexTracks_.push_back(std::move(track));
+        }
+    }
+    startThreadIfNeeded();
+    conditionVariable_.notify_all();
+}
+
+void SearchPrefetcher::addUnsavedIndexEntry() {
+    std::lock_guard lock(mutex_);
+    if (++unsavedIndexEntryCount_ >= INDEX_SAVE_INTERVAL) {
+        isIndexSavePending_ = true;
+        startThreadIfNeeded();
+        conditionVariable_.notify_all();
+    }
+}
+
+void SearchPrefetcher::setActive(const bool isActive) {
+    std::lock_guard lock(mutex_);
+    isActive_ = isActive;
+    if (!isActive) {
+        pendingTracks_.clear();
+        cancellationToken_.cancel();
+
+        // Write the entries of recent searches once the list is closed
+        if (unsavedIndexEntryCount_ > 0) {
+            isIndexSavePending_ = true;
+            startThreadIfNeeded();
+        }
+    }
+    conditionVariable_.notify_all();
+}
+
+void SearchPrefetcher::beginForegroundSearch() {
+    std::lock_guard lock(mutex_);
+    ++foregroundSearchCount_;
+
+    // Free up the connection for the foreground search. The interrupted track is retried afterward.
+    cancellationToken_.cancel();
+}
+
+void SearchPrefetcher::endForegroundSearch() {
+    std::lock_guard lock(mutex_);
+    if (foregroundSearchCount_ > 0) {
+        --foregroundSearchCount_;
+    }
+    conditionVariable_.notify_all();
+}
+
+bool SearchPrefetcher::canRun() const {
+    return isActive_ && foregroundSearchCount_ == 0;
+}
+
+bool SearchPrefetcher::hasWork() const {
+    // Saving doesn't use the network, so it doesn't wait for prefetching to be enabled
+    return (isIndexSavePending_ && foregroundSearchCount_ == 0) || (canRun() && (!pendingTracks_.empty() || !pendingIndexTracks_.empty()));
+}
+
+void SearchPrefetcher::startThreadIfNeeded() {
+    if (!isThreadRunning_ && (!pendingTracks_.empty() || !pendingIndexTracks_.empty() || isIndexSavePending_)) {
+        isThreadRunning_ = true;
+        std::thread([this]() {
+            run();
+        }).detach();
+    }
+}
+
+void SearchPrefetcher::run() {
+    // Lower the priority of this thread so it doesn't compete with the game or the foreground search. On Linux this
+    // only affects the calling thread.
+    setpriority(PRIO_PROCESS, 0, 10);
+
+    std::unique_lock lock(mutex_);
+    while (true) {
+        conditionVariable_.wait(lock, [this]() {
+            return hasWork();
+        });
+
+        // Saving is quick, and the neighbours of the selected track are more likely to be needed soon than the index
+        if (isIndexSavePending_ && foregroundSearchCount_ == 0) {
+            saveIndex(lock);
+        } else if (!pendingTracks_.empty()) {
+            prefetch(lock);
+        } else {
+            index(lock);
+        }
+    }
+}
+
+void SearchPrefetcher::prefetch(std::unique_lock<std::mutex>& lock) {
+    const airbuds::Track track = pendingTracks_.front();
+    cancellationToken_ = CancellationToken();
+    const CancellationToken cancellationToken = cancellationToken_;
+    lock.unlock();
+
+    const std::vector<Filter::ArtistMatchInfo> artistInfos = Filter::buildArtistInfos(track.artists);
+    const std::vector<Filter::QuerySpec> queries = Filter::buildBeatSaverQueries(track, artistInfos);
+    size_t fetchedCount = 0;
+    for (const Filter::QuerySpec& spec : queries) {
+        if (cancellationToken.isCancelled()) {
+            break;
+        }
+        const BeatSaverSearch::SearchPageResult result = BeatSaverSearch::fetchSearchPage(spec.query, 0, cancellationToken);
+        if (!result.cancelled) {
+            ++fetchedCount;
+        }
+    }
+
+    lock.lock();
+    if (cancellationToken.isCancelled()) {
+        // Interrupted by a foreground search or deactivation. Leave the track in the queue (if it is still there)
+        // so it is retried from the start. Queries that already finished are served from the cache.
+        return;
+    }
+    if (!pendingTracks_.empty() && pendingTracks_.front() == track) {
+        pendingTracks_.pop_front();
+    }
+    AirbudsSearch::Log.info("Prefetched search results: track = {} queries = {}/{}", track.id, fetchedCount, queries.size());
+}
+
+void SearchPrefetcher::index(std::unique_lock<std::mutex>& lock) {
+    const airbuds::Track track = pendingIndexTracks_.front();
+    cancellationToken_ = CancellationToken();
+    const CancellationToken cancellationToken = cancellationToken_;
+    lock.unlock();
+
+    TrackMatcher::Options options;
+    options.onlineSearch = isOnlineSearchEnabled();
+    const TrackMatcher::Result result = TrackMatcher::findMatches(track, options, cancellationToken);
+    if (!result.cancelled && result.hadAnySuccess) {
+        MatchIndex::getInstance().put(track.id, result);
+    }
+
+    lock.lock();
+    if (result.cancelled) {
+        // Retried once the foreground search is done
+        return;
+    }
+    if (!pendingIndexTracks_.empty() && pendingIndexTracks_.front() == track) {
+        pendingIndexTracks_.pop_front();
+    }
+    if (result.hadAnySuccess) {
+        ++unsavedIndexEntryCount_;
+    }
+    if (unsavedIndexEntryCount_ > 0 && (pendingIndexTracks_.empty() || unsavedIndexEntryCount_ >= INDEX_SAVE_INTERVAL)) {
+        isIndexSavePending_ = true;
+    }
+}
+
+void SearchPrefetcher::saveIndex(std::unique_lock<std::mutex>& lock) {
+    isIndexSavePending_ = false;
+    unsavedIndexEntryCount_ = 0;
+    lock.unlock();
+    MatchIndex::getInstance().save();
+    RomanizationCache::getInstance().save();
+    lock.lock();
+}
+
+}// namespace AirbudsSearch
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "Configuration.hpp"
+#include "FileUtils.hpp"
+#include "Log.hpp"
+#include "SearchResponseCache.hpp"
+
+namespace AirbudsSearch {
+
+// Each file starts with two header lines: the time the response was received (seconds since epoch) and the full key,
+// which guards against hash collisions. The rest of the file is the response body.
+
+std::filesystem::path SearchResponseCache::getCacheDirectory() {
+    return AirbudsSearch::getDataDirectory() / "cache" / "search";
+}
+
+std::filesystem::path SearchResponseCache::getPath(const std::string& key) {
+    return getCacheDirectory() / std::format("{:016x}", std::hash<std::string>{}(key));
+}
+
+std::optional<SearchResponseCache::Entry> SearchResponseCache::get(const std::string& key) {
+    if (getSearchCacheMaxSizeBytes() == 0) {
+        return std::nullopt;
+    }
+
+    const std::filesystem::path path = getPath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    std::string timestampLine;
+    std::string keyLine;
+    if (!std::getline(file, timestampLine) || !std::getline(file, keyLine) || keyLine != key) {
+        return std::nullopt;
+    }
+
+    int64_t timestamp = 0;
+    try {
+        timestamp = std::stoll(timestampLine);
+    } catch (const std::exception&) {
+        AirbudsSearch::Log.warn("Invalid search cache entry: {}", path.string());
+        return std::nullopt;
+    }
+    const auto age = std::chrono::system_clock::now() - std::chrono::system_clock::time_point(std::chrono::seconds(timestamp));
+    if (age > MAX_STALE_AGE) {
+        return std::nullopt;
+    }
+
+    std::stringstream body;
+    body << file.rdbuf();
+    Entry entry;
+    entry.body = body.str();
+    entry.isStale = age > getSearchCacheTtl();
+    return entry;
+}
+
+void SearchResponseCache::put(const std::string& key, const std::string& body) {
+    const uintmax_t maxSizeInBytes = getSearchCacheMaxSizeBytes();
+    if (maxSizeInBytes == 0) {
+        return;
+    }
+
+    const std::filesystem::path path = getPath(key);
+    std::error_code errorCode;
+    std::filesystem::create_directories(path.parent_path(), errorCode);
+
+    const int64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::string header = std::format("{}\n{}\n", timestamp, key);
+
+    // Written under the lock, so the size of the entry it replaces is still the one counted in the total
+    std::lock_guard lock(mutex_);
+    const uintmax_t previousTotalSizeInBytes = getTotalSizeInBytes();
+    const uintmax_t previousSize = std::filesystem::exists(path, errorCode) ? std::filesystem::file_size(path, errorCode) : 0;
+    if (!Utils::writeFileAtomically(path, {header, body})) {
+        return;
+    }
+    const uintmax_t newSize = std::filesystem::file_size(path, errorCode);
+    const uintmax_t totalSizeInBytes = previousTotalSizeInBytes - std::min(previousSize, previousTotalSizeInBytes) + newSize;
+    totalSizeInBytes_ = totalSizeInBytes;
+    if (totalSizeInBytes > maxSizeInBytes) {
+        evict(maxSizeInBytes);
+    }
+}
+
+bool SearchResponseCache::beginRevalidation(const std::string& key) {
+    std::lock_guard lock(mutex_);
+    return revalidatingKeys_.insert(key).second;
+}
+
+void SearchResponseCache::endRevalidation(const std::string& key) {
+    std::lock_guard lock(mutex_);
+    revalidatingKeys_.erase(key);
+}
+
+uintmax_t SearchResponseCache::getTotalSizeInBytes() {
+    // The cache directory can be deleted from the settings menu at any time, so recalculate if it is gone
+    std::error_code errorCode;
+    if (!totalSizeInBytes_ || !std::filesystem::exists(getCacheDirectory(), errorCode)) {
+        uintmax_t totalSizeInBytes = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(getCacheDirectory(), errorCode)) {
+            if (entry.is_regular_file(errorCode) && entry.path().extension() != ".tmp") {
+                totalSizeInBytes += entry.file_size(errorCode);
+            }
+        }
+        totalSizeInBytes_ = totalSizeInBytes;
+    }
+    return *totalSizeInBytes_;
+}
+
+void SearchResponseCache::evict(const uintmax_t maxSizeInBytes) {
+    struct CacheFile {
+        std::filesystem::path path;
+        std::filesystem::file_time_type lastWriteTime;
+        uintmax_t size;
+    };
+    std::vector<CacheFile> files;
+    uintmax_t totalSizeInBytes = 0;
+    std::error_code errorCode;
+    for (const auto& entry : std::filesystem::directory_iterator(getCacheDirectory(), errorCode)) {
+        if (!entry.is_regular_file(errorCode) || entry.path().extension() == ".tmp") {
+            continue;
+        }
+        const uintmax_t size = entry.file_size(errorCode);
+        files.push_back({entry.path(), entry.last_write_time(errorCode), size});
+        totalSizeInBytes += size;
+    }
+
+    // Remove the oldest entries until we are comfortably below the limit, so we don't evict on every write
+    const uintmax_t targetSizeInBytes = maxSizeInBytes / 10 * 9;
+    std::ranges::sort(files, [](const CacheFile& a, const CacheFile& b) {
+        return a.lastWriteTime < b.lastWriteTime;
+    });
+    size_t removedCount = 0;
+    for (const CacheFile& file : files) {
+        if (totalSizeInBytes <= targetSizeInBytes) {
+            break;
+        }
+        if (std::filesystem::remove(file.path, errorCode)) {
+            totalSizeInBytes -= file.size;
+            ++removedCount;
+        }
+    }
+    totalSizeInBytes_ = totalSizeInBytes;
+    AirbudsSearch::Log.info("Search cache evicted {} entries, size = {} bytes.", removedCount, totalSizeInBytes);
+}
+
+}// namespace AirbudsSearch
@@ -0,0 +1,32 @@
+#include <algorithm>
+
+#include "SongDetailsMatching.hpp"
+
+namespace AirbudsSearch::Filter {
+
+bool candidateHasDifficulty(const BeatSaverSearch::SearchCandidate& candidate, const std::vector<SongDetailsCache::MapDifficulty>& difficulties) {
+    return std::ranges::any_of(difficulties, [&candidate](const SongDetailsCache::MapDifficulty difficulty) {
+        return (candidate.difficultyMask & (1u << static_cast<uint8_t>(difficulty))) != 0;
+    });
+}
+
+bool songHasDifficulty(const SongDetailsCache::Song& song, const std::vector<SongDetailsCache::MapDifficulty>& difficulties) {
+    if (difficulties.empty()) {
+        return false;
+    }
+    for (const SongDetailsCache::SongDifficulty& songDifficulty : song) {
+        if (std::ranges::find(difficulties, songDifficulty.difficulty) != difficulties.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void addSongCandidate(Scoring::CandidateBatch& batch, const SongDetailsCache::Song& song, const bool hasDifficulty) {
+    // SongDetails doesn't store the BeatSaver rating, so approximate it from the vote counts
+    const uint32_t totalVotes = song.upvotes + song.downvotes;
+    const float rating = totalVotes > 0 ? static_cast<float>(song.upvotes) / static_cast<float>(totalVotes) : 0.0f;
+    batch.add(song.songName(), "", song.songAuthorName(), song.levelAuthorName(), rating, hasDifficulty);
+}
+
+}// namespace AirbudsSearch::Filter
@@ -1,3 +1,5 @@
+#include <atomic>
+
 #include "ThreadPool.hpp"
 
 namespace AirbudsSearch {
@@ -13,7 +15,8 @@ void ThreadPool::submit(const std::function<void()>& task) {
     });
 
     // Create a job
-    static size_t id = 0;
+    // Shared by every pool, and pools are used from several threads at once
+    static std::atomic<size_t> id = 0;
     Job job{id++, task};
     std::thread thread([this, job]() {
         job.task_();
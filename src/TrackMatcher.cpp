@@ -0,0 +1,490 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "songcore/shared/SongCore.hpp"
+
+#include "BeatSaverSearch.hpp"
+#include "Configuration.hpp"
+#include "Filter.hpp"
+#include "LocalSongIndex.hpp"
+#include "Log.hpp"
+#include "ScoringPipeline.hpp"
+#include "SongDetailsMatching.hpp"
+#include "ThreadPool.hpp"
+#include "TrackMatcher.hpp"
+
+namespace AirbudsSearch::TrackMatcher {
+
+// Number of results on a BeatSaver search page
+static constexpr size_t PAGE_SIZE = 20;
+
+// Number of local index results considered per query. Matches the size of a BeatSaver search page.
+static constexpr size_t LOCAL_RESULTS_PER_QUERY = PAGE_SIZE;
+
+// Further pages are only fetched while they could still change the results, and never more than this
+static constexpr size_t MAX_PAGES_PER_QUERY = 3;
+static_assert(MAX_PAGES_PER_QUERY * PAGE_SIZE <= 100, "Result positions must fit in the rank range of a query");
+
+// Number of results that a further page has to be able to beat to be worth fetching
+static constexpr size_t PAGE_TARGET_RESULT_COUNT = 20;
+
+// Match score of a candidate whose name and artist both match exactly. Once a query found one, the queries with a
+// lower base score are skipped.
+static constexpr int HIGH_CONFIDENCE_MATCH_SCORE = 2400;
+
+bool isBetterMatch(const Match& a, const Match& b) {
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    return a.rank < b.rank;
+}
+
+namespace {
+
+struct SearchStats {
+    size_t missingInCache = 0;
+    size_t duplicateHashes = 0;
+    size_t filteredDownloaded = 0;
+    size_t mappedByHash = 0;
+    size_t mappedByKey = 0;
+    size_t mappedById = 0;
+    size_t difficultyBonusCount = 0;
+    size_t totalDocs = 0;
+    size_t localResults = 0;
+    size_t extraPages = 0;
+    size_t skippedQueries = 0;
+};
+
+// Collects the matches of every query. Matches are keyed by hash and only ever replaced by a better (score, rank)
+// pair, so the merged result doesn't depend on the order in which the queries finish. Not thread-safe.
+class MatchCollector {
+    public:
+    void merge(std::vector<std::pair<std::string, Match>>& scoredSongs, SearchStats& stats) {
+        for (auto& [songHash, match] : scoredSongs) {
+            auto it = matches_.find(songHash);
+            if (it == matches_.end()) {
+                matches_.emplace(std::move(songHash), match);
+            } else {
+                ++stats.duplicateHashes;
+                if (isBetterMatch(match, it->second)) {
+                    it->second = match;
+                }
+            }
+        }
+    }
+
+    // Returns the best matches collected so far, best first
+    std::vector<Match> getTopMatches(const size_t limit) const {
+        std::vector<Match> sortedMatches;
+        sortedMatches.reserve(matches_.size());
+        for (const auto& [hash, match] : matches_) {
+            if (match.song) {
+                sortedMatches.push_back(match);
+            }
+        }
+        const size_t count = std::min(limit, sortedMatches.size());
+        std::partial_sort(sortedMatches.begin(), sortedMatches.begin() + count, sortedMatches.end(), isBetterMatch);
+        sortedMatches.resize(count);
+        return sortedMatches;
+    }
+
+    size_t size() const {
+        return matches_.size();
+    }
+
+    // Returns the score of the n-th best match, or nothing if there are fewer matches
+    std::optional<int> getNthBestScore(const size_t n) const {
+        if (n == 0 || matches_.size() < n) {
+            return std::nullopt;
+        }
+        std::vector<int> scores;
+        scores.reserve(matches_.size());
+        for (const auto& [hash, match] : matches_) {
+            scores.push_back(match.score);
+        }
+        std::nth_element(scores.begin(), scores.begin() + (n - 1), scores.end(), std::greater<>());
+        return scores[n - 1];
+    }
+
+    private:
+    std::unordered_map<std::string, Match> matches_;
+};
+
+}// namespace
+
+Result findMatches(
+    const airbuds::Track& track,
+    const Options& options,
+    const CancellationToken& cancellationToken,
+    const PartialResultsCallback& onPartialResults,
+    const size_t partialResultCount) {
+    const Filter::TrackMatchInfo trackInfo = Filter::buildTrackMatchInfo(track);
+    const std::vector<Filter::QuerySpec> queries = Filter::buildBeatSaverQueries(track, trackInfo.artists);
+    std::string artistNames;
+    for (size_t i = 0; i < track.artists.size(); ++i) {
+        if (i > 0) {
+            artistNames += ", ";
+        }
+        artistNames += track.artists[i].name;
+    }
+    AirbudsSearch::Log.info(
+        "Searching for track: id={} name=\"{}\" artists=\"{}\" artistsRomaji=\"{}\" romaji=\"{}\"",
+        track.id,
+        track.name,
+        artistNames,
+        Filter::getArtistRomajiLog(trackInfo.artists),
+        trackInfo.romaji);
+    if (queries.empty()) {
+        AirbudsSearch::Log.warn("BeatSaver search skipped: no query terms available.");
+    } else {
+        std::string queryLog;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            if (i > 0) {
+                queryLog += " | ";
+            }
+            queryLog += std::format("[{}:{}] {}", queries[i].label, queries[i].baseScore, queries[i].query);
+        }
+        AirbudsSearch::Log.info("BeatSaver search queries: {}", queryLog);
+    }
+
+    Result result;
+    result.queryCount = queries.size();
+    SongDetailsCache::SongDetails* songDetails = SongDetailsCache::SongDetails::Init().get();
+    if (!songDetails) {
+        AirbudsSearch::Log.warn("SongDetails cache is not available yet.");
+    }
+
+    const auto searchStartTime = std::chrono::high_resolution_clock::now();
+
+    // Shared between the request threads
+    std::mutex matchesMutex;
+    MatchCollector collector;
+    SearchStats stats;
+    size_t completedQueries = 0;
+
+    // Numbers the partial results in the order they were taken from the collector
+    uint64_t partialResultSequence = 0;
+
+    // Highest base score of a query that found a high-confidence match
+    std::optional<int> highConfidenceBaseScore;
+
+    struct PageOutcome {
+        size_t docCount = 0;
+        int bestMatchScore = 0;
+    };
+
+    // Must be called with matchesMutex held
+    const auto updateHighConfidenceBaseScore = [&highConfidenceBaseScore](const int baseScore, const int matchScore) {
+        if (matchScore >= HIGH_CONFIDENCE_MATCH_SCORE && (!highConfidenceBaseScore || baseScore > *highConfidenceBaseScore)) {
+            highConfidenceBaseScore = baseScore;
+        }
+    };
+
+    const auto onPageFinished = [&](const size_t queryIndex, const size_t page, const bool isLastPage, const BeatSaverSearch::SearchPageResult& pageResult) {
+        const auto& spec = queries[queryIndex];
+        PageOutcome outcome;
+        if (!pageResult.successful) {
+            std::lock_guard lock(matchesMutex);
+            result.hadAnyFailure = true;
+            ++completedQueries;
+            return outcome;
+        }
+
+        // Map the docs and score them as one batch without holding the lock
+        SearchStats queryStats;
+        struct MappedDoc {
+            std::string songHash;
+            const SongDetailsCache::Song* song;
+            size_t docIndex;
+        };
+        std::vector<MappedDoc> mappedDocs;
+        Scoring::CandidateBatch batch(trackInfo);
+        const auto& docs = pageResult.docs;
+        outcome.docCount = docs.size();
+        queryStats.totalDocs = docs.size();
+        mappedDocs.reserve(docs.size());
+        batch.reserve(docs.size());
+        AirbudsSearch::Log.info("BeatSaver search results: query=\"{}\" page={} count={}", spec.query, page, docs.size());
+        for (size_t pageDocIndex = 0; pageDocIndex < docs.size(); ++pageDocIndex) {
+            if (cancellationToken.isCancelled()) {
+                return outcome;
+            }
+            const size_t docIndex = page * PAGE_SIZE + pageDocIndex;
+            const BeatSaverSearch::SearchCandidate& candidate = docs[pageDocIndex];
+            if (candidate.hash.empty()) {
+                continue;
+            }
+
+            const SongDetailsCache::Song* song = nullptr;
+            bool mapped = false;
+            if (songDetails && songDetails->songs.FindByHash(candidate.hash, song) && song) {
+                mapped = true;
+                ++queryStats.mappedByHash;
+            } else if (songDetails) {
+                if (candidate.key && songDetails->songs.FindByMapId(*candidate.key, song) && song) {
+                    mapped = true;
+                    ++queryStats.mappedByKey;
+                } else if (!candidate.id.empty() && songDetails->songs.FindByMapId(candidate.id, song) && song) {
+                    mapped = true;
+                    ++queryStats.mappedById;
+                }
+            }
+            if (!mapped || !song) {
+                ++queryStats.missingInCache;
+                continue;
+            }
+
+            std::string songHash = song->hash();
+            if (!options.includeDownloadedSongs && SongCore::API::Loading::GetLevelByHash(songHash)) {
+                ++queryStats.filteredDownloaded;
+                continue;
+            }
+
+            const bool hasDifficultyBonus = Filter::candidateHasDifficulty(candidate, options.difficulties);
+            if (hasDifficultyBonus) {
+                ++queryStats.difficultyBonusCount;
+            }
+            batch.addSearchCandidate(candidate, hasDifficultyBonus);
+            mappedDocs.push_back(MappedDoc{std::move(songHash), song, docIndex});
+        }
+
+        const std::vector<int> matchScores = Scoring::scoreBatch(trackInfo, batch, options.artistBoost);
+        std::vector<std::pair<std::string, Match>> scoredDocs;
+        scoredDocs.reserve(mappedDocs.size());
+        for (size_t i = 0; i < mappedDocs.size(); ++i) {
+            MappedDoc& mappedDoc = mappedDocs[i];
+            outcome.bestMatchScore = std::max(outcome.bestMatchScore, matchScores[i]);
+            const int score = Scoring::getResultScore(spec.baseScore, matchScores[i], mappedDoc.docIndex);
+            const int rank = Scoring::getResultRank(queryIndex, mappedDoc.docIndex);
+            scoredDocs.emplace_back(std::move(mappedDoc.songHash), Match{mappedDoc.song, score, rank});
+        }
+
+        std::vector<Match> partialMatches;
+        uint64_t sequence = 0;
+        {
+            std::lock_guard lock(matchesMutex);
+            result.hadAnySuccess = true;
+            if (isLastPage) {
+                ++completedQueries;
+            }
+            stats.missingInCache += queryStats.missingInCache;
+            stats.filteredDownloaded += queryStats.filteredDownloaded;
+            stats.mappedByHash += queryStats.mappedByHash;
+            stats.mappedByKey += queryStats.mappedByKey;
+            stats.mappedById += queryStats.mappedById;
+            stats.difficultyBonusCount += queryStats.difficultyBonusCount;
+            stats.totalDocs += queryStats.totalDocs;
+            collector.merge(scoredDocs, stats);
+            updateHighConfidenceBaseScore(spec.baseScore, outcome.bestMatchScore);
+
+            if (!onPartialResults || completedQueries >= queries.size()) {
+                return outcome;
+            }
+            partialMatches = collector.getTopMatches(partialResultCount);
+            sequence = ++partialResultSequence;
+        }
+
+        // Report what we have so far. The final pass below settles the order once every query is done.
+        if (cancellationToken.isCancelled()) {
+            return outcome;
+        }
+        onPartialResults(partialMatches, sequence);
+        return outcome;
+    };
+
+    // A query is skipped if a query with a higher base score already found a high-confidence match, its results
+    // can't rank above that match anyway. Must be called with matchesMutex held.
+    const auto shouldSkipQuery = [&highConfidenceBaseScore](const Filter::QuerySpec& spec) {
+        return highConfidenceBaseScore && spec.baseScore < *highConfidenceBaseScore;
+    };
+
+    // The next page is fetched only if it could still place a match in the top results. BeatSaver's relevance order
+    // says nothing about our match score, so the bound is the highest match score any map could get for this track.
+    // Every result on the next page is at least PAGE_SIZE positions further down. Must be called with matchesMutex held.
+    const int maxMatchScore = Scoring::getMaxMatchScore(trackInfo, options.artistBoost, !options.difficulties.empty());
+    const auto shouldFetchNextPage = [&collector, &highConfidenceBaseScore, maxMatchScore](const Filter::QuerySpec& spec, const size_t page, const PageOutcome& outcome) {
+        if (page + 1 >= MAX_PAGES_PER_QUERY || outcome.docCount < PAGE_SIZE || highConfidenceBaseScore) {
+            return false;
+        }
+        const std::optional<int> scoreToBeat = collector.getNthBestScore(PAGE_TARGET_RESULT_COUNT);
+        if (!scoreToBeat) {
+            return true;
+        }
+        const int nextPageUpperBound = Scoring::getResultScore(spec.baseScore, maxMatchScore, (page + 1) * PAGE_SIZE);
+        return nextPageUpperBound > *scoreToBeat;
+    };
+
+    // Search the local index first. It only needs the SongDetails cache, so these results are available immediately
+    // and the online search below only adds to them.
+    const LocalSongIndex& localSongIndex = LocalSongIndex::getInstance();
+    const bool useLocalIndex = localSongIndex.isReady();
+    if (useLocalIndex) {
+        const auto localStartTime = std::chrono::high_resolution_clock::now();
+        std::vector<std::pair<std::string, Match>> scoredSongs;
+        for (size_t queryIndex = 0; queryIndex < queries.size(); ++queryIndex) {
+            if (cancellationToken.isCancelled()) {
+                result.cancelled = true;
+                return result;
+            }
+            const auto& spec = queries[queryIndex];
+            const std::vector<const SongDetailsCache::Song*> localSongs = localSongIndex.search(spec.query, LOCAL_RESULTS_PER_QUERY);
+            Scoring::CandidateBatch batch(trackInfo);
+            batch.reserve(localSongs.size());
+            std::vector<size_t> songIndices;
+            songIndices.reserve(localSongs.size());
+            for (size_t songIndex = 0; songIndex < localSongs.size(); ++songIndex) {
+                const SongDetailsCache::Song* song = localSongs[songIndex];
+                if (!options.includeDownloadedSongs && SongCore::API::Loading::GetLevelByHash(song->hash())) {
+                    ++stats.filteredDownloaded;
+                    continue;
+                }
+                Filter::addSongCandidate(batch, *song, Filter::songHasDifficulty(*song, options.difficulties));
+                songIndices.push_back(songIndex);
+            }
+
+            const std::vector<int> matchScores = Scoring::scoreBatch(trackInfo, batch, options.artistBoost);
+            int bestMatchScore = 0;
+            for (size_t i = 0; i < songIndices.size(); ++i) {
+                const size_t songIndex = songIndices[i];
+                const SongDetailsCache::Song* song = localSongs[songIndex];
+                const int score = Scoring::getResultScore(spec.baseScore, matchScores[i], songIndex);
+
+                // Ranked after every online result, so a local and an online song never tie on (score, rank)
+                const int rank = Scoring::getResultRank(queries.size() + queryIndex, songIndex);
+                scoredSongs.emplace_back(song->hash(), Match{song, score, rank});
+                bestMatchScore = std::max(bestMatchScore, matchScores[i]);
+            }
+            std::lock_guard lock(matchesMutex);
+            updateHighConfidenceBaseScore(spec.baseScore, bestMatchScore);
+        }
+        stats.localResults = scoredSongs.size();
+
+        std::vector<Match> localMatches;
+        uint64_t sequence = 0;
+        {
+            std::lock_guard lock(matchesMutex);
+            collector.merge(scoredSongs, stats);
+            result.hadAnySuccess = true;
+            if (onPartialResults && options.onlineSearch && !queries.empty()) {
+                localMatches = collector.getTopMatches(partialResultCount);
+                sequence = ++partialResultSequence;
+            }
+        }
+        AirbudsSearch::Log.info(
+            "Local search results: count={} candidates={} time = {} ms.",
+            stats.localResults,
+            collector.size(),
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - localStartTime).count());
+        if (!localMatches.empty()) {
+            onPartialResults(localMatches, sequence);
+        }
+    } else {
+        AirbudsSearch::Log.info("Local song index is not ready yet, using online search only.");
+    }
+
+    // Send all queries at once (bounded by the configured request limit)
+    if (options.onlineSearch || !useLocalIndex) {
+        ThreadPool requestPool(getSearchMaxConcurrentRequests());
+        for (size_t queryIndex = 0; queryIndex < queries.size(); ++queryIndex) {
+            if (cancellationToken.isCancelled()) {
+                break;
+            }
+            requestPool.submit([&, queryIndex]() {
+                const auto& spec = queries[queryIndex];
+                for (size_t page = 0; page < MAX_PAGES_PER_QUERY; ++page) {
+                    if (page == 0) {
+                        std::lock_guard lock(matchesMutex);
+                        if (shouldSkipQuery(spec)) {
+                            ++stats.skippedQueries;
+                            ++completedQueries;
+                            AirbudsSearch::Log.info("BeatSaver search skipped: label={} (high-confidence match already found)", spec.label);
+                            return;
+                        }
+                    }
+                    AirbudsSearch::Log.info("BeatSaver search: label={} query=\"{}\" page={}", spec.label, spec.query, page);
+                    const BeatSaverSearch::SearchPageResult pageResult = BeatSaverSearch::fetchSearchPage(spec.query, static_cast<int>(page), cancellationToken);
+                    if (pageResult.cancelled || cancellationToken.isCancelled()) {
+                        return;
+                    }
+
+                    // A short or failed page is the last one regardless of the scores, so the query counts as
+                    // completed when it is merged and progressive results know when every query is done
+                    const bool isLastPossiblePage = page + 1 >= MAX_PAGES_PER_QUERY || pageResult.docs.size() < PAGE_SIZE || !pageResult.successful;
+                    const PageOutcome outcome = onPageFinished(queryIndex, page, isLastPossiblePage, pageResult);
+                    if (isLastPossiblePage) {
+                        return;
+                    }
+                    bool fetchNextPage = false;
+                    {
+                        std::lock_guard lock(matchesMutex);
+                        fetchNextPage = shouldFetchNextPage(spec, page, outcome);
+                        if (fetchNextPage) {
+                            ++stats.extraPages;
+                        } else {
+                            ++completedQueries;
+                        }
+                    }
+                    if (!fetchNextPage) {
+                        return;
+                    }
+                }
+            });
+        }
+        requestPool.wait();
+    }
+
+    if (cancellationToken.isCancelled()) {
+        AirbudsSearch::Log.info(
+            "Search cancelled: track = {} time = {} ms.",
+            track.id,
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - searchStartTime).count());
+        result.cancelled = true;
+        return result;
+    }
+
+    // Final pass over every collected match
+    result.matches = collector.getTopMatches(collector.size());
+
+    AirbudsSearch::Log.info(
+        "Search mapped songs = {} candidates={} localResults={} totalDocs={} extraPages={} skippedQueries={} missingInCache={} duplicates={} filteredDownloaded={} difficultyBonus={} mappedByHash={} mappedByKey={} mappedById={} time = {} ms.",
+        result.matches.size(),
+        collector.size(),
+        stats.localResults,
+        stats.totalDocs,
+        stats.extraPages,
+        stats.skippedQueries,
+        stats.missingInCache,
+        stats.duplicateHashes,
+        stats.filteredDownloaded,
+        stats.difficultyBonusCount,
+        stats.mappedByHash,
+        stats.mappedByKey,
+        stats.mappedById,
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - searchStartTime).count());
+
+    if (result.hadAnyFailure && !result.hadAnySuccess) {
+        AirbudsSearch::Log.warn("All BeatSaver search requests failed.");
+    }
+
+    const size_t previewCount = std::min<size_t>(5, result.matches.size());
+    for (size_t i = 0; i < previewCount; ++i) {
+        const Match& match = result.matches.at(i);
+        const SongDetailsCache::Song* song = match.song;
+        AirbudsSearch::Log.info(
+            "Search result[{}]: score={} name=\"{}\" author=\"{}\" hash={}",
+            i,
+            match.score,
+            song->songName(),
+            song->songAuthorName(),
+            song->hash());
+    }
+
+    return result;
+}
+
+}// namespace AirbudsSearch::TrackMatcher
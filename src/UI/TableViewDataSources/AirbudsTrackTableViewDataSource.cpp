@@ -262,3 +262,33 @@ int AirbudsTrackTableViewDataSource::getRowIndexForTrack(const airbuds::Playlist
     }
     return -1;
 }
+
+std::vector<airbuds::PlaylistTrack> AirbudsTrackTableViewDataSource::getTracksAroundRow(int idx, size_t count) const {
+    std::vector<airbuds::PlaylistTrack> tracks;
+    if (idx < 0 || static_cast<size_t>(idx) >= rows_.size() || count == 0) {
+        return tracks;
+    }
+
+    const int rowCount = static_cast<int>(rows_.size());
+    int next = idx + 1;
+    int previous = idx - 1;
+    size_t nextCount = 0;
+    size_t previousCount = 0;
+    while ((nextCount < count && next < rowCount) || (previousCount < count && previous >= 0)) {
+        while (next < rowCount && rows_[next].type != RowType::Track) {
+            ++next;
+        }
+        if (nextCount < count && next < rowCount) {
+            tracks.push_back(rows_[next++].track);
+            ++nextCount;
+        }
+        while (previous >= 0 && rows_[previous].type != RowType::Track) {
+            --previous;
+        }
+        if (previousCount < count && previous >= 0) {
+            tracks.push_back(rows_[previous--].track);
+            ++previousCount;
+        }
+    }
+    return tracks;
+}
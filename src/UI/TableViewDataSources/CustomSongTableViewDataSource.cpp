@@ -41,3 +41,11 @@ float CustomSongTableViewDataSource::CellSize() {
 void CustomSongTableViewDataSource::setSource(const std::vector<const SongDetailsCache::Song*>& source) {
     customSongs_ = source;
 }
+
+bool CustomSongTableViewDataSource::updateSource(const std::vector<const SongDetailsCache::Song*>& source) {
+    if (customSongs_ == source) {
+        return false;
+    }
+    customSongs_ = source;
+    return true;
+}
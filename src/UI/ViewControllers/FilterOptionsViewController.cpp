@@ -107,6 +107,7 @@ void FilterOptionsViewController::reloadFriendList() {
                 status = "Airbuds client missing.";
             } else {
                 friends = AirbudsSearch::airbudsClient->getFriends();
+                AirbudsSearch::airbudsClient->refreshFriendHistoriesAsync(friends);
             }
         } catch (const std::exception& exception) {
             AirbudsSearch::Log.warn("Failed loading friends: {}", exception.what());
@@ -7,6 +7,7 @@
 #include <fstream>
 #include <future>
 #include <mutex>
+#include <optional>
 #include <random>
 #include <string>
 #include <thread>
@@ -38,8 +39,10 @@
 #include "HMUI/Touchable.hpp"
 #include "Log.hpp"
 #include "Configuration.hpp"
-#include "JapaneseConverter.hpp"
+#include "MatchIndex.hpp"
+#include "SearchPrefetcher.hpp"
 #include "SpriteCache.hpp"
+#include "TrackMatcher.hpp"
 #include "UI/FlowCoordinators/AirbudsSearchFlowCoordinator.hpp"
 #include "UI/TableViewDataSources/CustomSongTableViewDataSource.hpp"
 #include "UI/TableViewDataSources/DownloadHistoryTableViewDataSource.hpp"
@@ -50,1240 +53,12 @@
 #include "main.hpp"
 #include "scotland2/shared/modloader.h"
 
-#include <dlfcn.h>
-#include <cstring>
-
 DEFINE_TYPE(AirbudsSearch::UI::ViewControllers, MainViewController);
 
 using namespace AirbudsSearch::UI::ViewControllers;
 
-namespace AirbudsSearch::Filter {
-
-static bool isHiragana(uint32_t codepoint);
-static bool isKatakana(uint32_t codepoint);
-static bool isKanji(uint32_t codepoint);
-static std::vector<uint32_t> decodeUtf8(const std::string& text, bool& hasKana, bool& hasKanji);
-
-static std::vector<std::string> getWords(const std::string& text) {
-    std::vector<std::string> words;
-    bool hasKana = false;
-    bool hasKanji = false;
-    const std::vector<uint32_t> codepoints = decodeUtf8(text, hasKana, hasKanji);
-    std::string current;
-    current.reserve(text.size());
-
-    auto flush = [&]() {
-        if (!current.empty()) {
-            words.emplace_back(AirbudsSearch::Utils::toLowerCase(current));
-            current.clear();
-        }
-    };
-
-    auto appendUtf8 = [&](const uint32_t codepoint) {
-        if (codepoint <= 0x7F) {
-            current.push_back(static_cast<char>(codepoint));
-            return;
-        }
-        if (codepoint <= 0x7FF) {
-            current.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
-            current.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
-            return;
-        }
-        if (codepoint <= 0xFFFF) {
-            current.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
-            current.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
-            current.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
-            return;
-        }
-        current.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
-        current.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
-        current.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
-        current.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
-    };
-
-    auto isWordCodepoint = [&](const uint32_t codepoint) {
-        if (codepoint <= 0x7F) {
-            return std::isalnum(static_cast<unsigned char>(codepoint)) != 0;
-        }
-        return isHiragana(codepoint)
-            || isKatakana(codepoint)
-            || isKanji(codepoint)
-            || codepoint == 0x30FC
-            || codepoint == 0x3005;
-    };
-
-    for (const uint32_t codepoint : codepoints) {
-        if (isWordCodepoint(codepoint)) {
-            appendUtf8(codepoint);
-            continue;
-        }
-        flush();
-    }
-    flush();
-
-    return words;
-}
-
-static bool isHiragana(const uint32_t codepoint) {
-    return codepoint >= 0x3040 && codepoint <= 0x309F;
-}
-
-static bool isKatakana(const uint32_t codepoint) {
-    return codepoint >= 0x30A0 && codepoint <= 0x30FF;
-}
-
-static bool isKanji(const uint32_t codepoint) {
-    return (codepoint >= 0x4E00 && codepoint <= 0x9FFF)
-        || (codepoint >= 0x3400 && codepoint <= 0x4DBF)
-        || (codepoint >= 0xF900 && codepoint <= 0xFAFF);
-}
-
-static bool isJapaneseCodepoint(const uint32_t codepoint) {
-    return isHiragana(codepoint)
-        || isKatakana(codepoint)
-        || isKanji(codepoint)
-        || codepoint == 0x3005;
-}
-
-static uint32_t toHiragana(const uint32_t codepoint) {
-    if (codepoint >= 0x30A1 && codepoint <= 0x30F6) {
-        return codepoint - 0x60;
-    }
-    return codepoint;
-}
-
-static bool isSmallVowel(const uint32_t codepoint) {
-    switch (codepoint) {
-        case 0x3041:
-        case 0x3043:
-        case 0x3045:
-        case 0x3047:
-        case 0x3049:
-            return true;
-        default:
-            return false;
-    }
-}
-
-static bool isSmallY(const uint32_t codepoint) {
-    switch (codepoint) {
-        case 0x3083:
-        case 0x3085:
-        case 0x3087:
-            return true;
-        default:
-            return false;
-    }
-}
-
-static const char* getSmallVowelRomaji(const uint32_t codepoint) {
-    switch (codepoint) {
-        case 0x3041:
-            return "a";
-        case 0x3043:
-            return "i";
-        case 0x3045:
-            return "u";
-        case 0x3047:
-            return "e";
-        case 0x3049:
-            return "o";
-        default:
-            return "";
-    }
-}
-
-static const char* getSmallYRomaji(const uint32_t codepoint) {
-    switch (codepoint) {
-        case 0x3083:
-            return "ya";
-        case 0x3085:
-            return "yu";
-        case 0x3087:
-            return "yo";
-        default:
-            return "";
-    }
-}
-
-static const char* kanaToRomaji(const uint32_t codepoint) {
-    switch (codepoint) {
-        case 0x3042: return "a";
-        case 0x3044: return "i";
-        case 0x3046: return "u";
-        case 0x3048: return "e";
-        case 0x304A: return "o";
-        case 0x304B: return "ka";
-        case 0x304D: return "ki";
-        case 0x304F: return "ku";
-        case 0x3051: return "ke";
-        case 0x3053: return "ko";
-        case 0x3055: return "sa";
-        case 0x3057: return "shi";
-        case 0x3059: return "su";
-        case 0x305B: return "se";
-        case 0x305D: return "so";
-        case 0x305F: return "ta";
-        case 0x3061: return "chi";
-        case 0x3064: return "tsu";
-        case 0x3066: return "te";
-        case 0x3068: return "to";
-        case 0x306A: return "na";
-        case 0x306B: return "ni";
-        case 0x306C: return "nu";
-        case 0x306D: return "ne";
-        case 0x306E: return "no";
-        case 0x306F: return "ha";
-        case 0x3072: return "hi";
-        case 0x3075: return "fu";
-        case 0x3078: return "he";
-        case 0x307B: return "ho";
-        case 0x307E: return "ma";
-        case 0x307F: return "mi";
-        case 0x3080: return "mu";
-        case 0x3081: return "me";
-        case 0x3082: return "mo";
-        case 0x3084: return "ya";
-        case 0x3086: return "yu";
-        case 0x3088: return "yo";
-        case 0x3089: return "ra";
-        case 0x308A: return "ri";
-        case 0x308B: return "ru";
-        case 0x308C: return "re";
-        case 0x308D: return "ro";
-        case 0x308F: return "wa";
-        case 0x3090: return "wi";
-        case 0x3091: return "we";
-        case 0x3092: return "o";
-        case 0x3093: return "n";
-        case 0x304C: return "ga";
-        case 0x304E: return "gi";
-        case 0x3050: return "gu";
-        case 0x3052: return "ge";
-        case 0x3054: return "go";
-        case 0x3056: return "za";
-        case 0x3058: return "ji";
-        case 0x305A: return "zu";
-        case 0x305C: return "ze";
-        case 0x305E: return "zo";
-        case 0x3060: return "da";
-        case 0x3062: return "ji";
-        case 0x3065: return "zu";
-        case 0x3067: return "de";
-        case 0x3069: return "do";
-        case 0x3070: return "ba";
-        case 0x3073: return "bi";
-        case 0x3076: return "bu";
-        case 0x3079: return "be";
-        case 0x307C: return "bo";
-        case 0x3071: return "pa";
-        case 0x3074: return "pi";
-        case 0x3077: return "pu";
-        case 0x307A: return "pe";
-        case 0x307D: return "po";
-        case 0x3094: return "vu";
-        case 0x3095: return "ka";
-        case 0x3096: return "ke";
-        default:
-            return "";
-    }
-}
-
-static char getLastVowel(const std::string& text) {
-    for (auto it = text.rbegin(); it != text.rend(); ++it) {
-        switch (*it) {
-            case 'a':
-            case 'i':
-            case 'u':
-            case 'e':
-            case 'o':
-                return *it;
-            default:
-                break;
-        }
-    }
-    return '\0';
-}
-
-static void appendSpaceIfNeeded(std::string& text) {
-    if (!text.empty() && text.back() != ' ') {
-        text.push_back(' ');
-    }
-}
-
-static void appendUtf8(std::string& text, const uint32_t codepoint) {
-    if (codepoint <= 0x7F) {
-        text.push_back(static_cast<char>(codepoint));
-        return;
-    }
-    if (codepoint <= 0x7FF) {
-        text.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
-        text.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
-        return;
-    }
-    if (codepoint <= 0xFFFF) {
-        text.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
-        text.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
-        text.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
-        return;
-    }
-    text.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
-    text.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
-    text.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
-    text.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
-}
-
-static std::string doubleLeadingConsonant(const std::string& romaji) {
-    if (romaji.empty()) {
-        return romaji;
-    }
-    const char first = romaji.front();
-    if (first == 'a' || first == 'i' || first == 'u' || first == 'e' || first == 'o') {
-        return romaji;
-    }
-    return std::string(1, first) + romaji;
-}
-
-static std::string combineYoon(const std::string& base, const uint32_t smallY) {
-    const char* y = getSmallYRomaji(smallY);
-    if (!y || y[0] == '\0') {
-        return "";
-    }
-
-    if (base == "shi") {
-        return std::string("sh") + y;
-    }
-    if (base == "chi") {
-        return std::string("ch") + y;
-    }
-    if (base == "ji") {
-        return std::string("j") + y;
-    }
-    if (!base.empty() && base.back() == 'i') {
-        return base.substr(0, base.size() - 1) + y;
-    }
-    return "";
-}
-
-static std::string combineSmallVowel(const std::string& base, const uint32_t smallVowel) {
-    const char* vowel = getSmallVowelRomaji(smallVowel);
-    if (!vowel || vowel[0] == '\0') {
-        return "";
-    }
-
-    const char v = vowel[0];
-    if (base == "fu") {
-        return std::string("f") + vowel;
-    }
-    if (base == "vu") {
-        return std::string("v") + vowel;
-    }
-    if (base == "te" && v == 'i') {
-        return "ti";
-    }
-    if (base == "de" && v == 'i') {
-        return "di";
-    }
-    if (base == "to" && v == 'u') {
-        return "tu";
-    }
-    if (base == "do" && v == 'u') {
-        return "du";
-    }
-    if (base == "shi" && v == 'e') {
-        return "she";
-    }
-    if (base == "chi" && v == 'e') {
-        return "che";
-    }
-    if (base == "ji" && v == 'e') {
-        return "je";
-    }
-    if (base == "su" && v == 'i') {
-        return "si";
-    }
-    if (base == "zu" && v == 'i') {
-        return "zi";
-    }
-    if (base == "tsu") {
-        switch (v) {
-            case 'a': return "tsa";
-            case 'i': return "tsi";
-            case 'e': return "tse";
-            case 'o': return "tso";
-            default: break;
-        }
-    }
-    if (base == "ku") {
-        switch (v) {
-            case 'a': return "kwa";
-            case 'i': return "kwi";
-            case 'e': return "kwe";
-            case 'o': return "kwo";
-            default: break;
-        }
-    }
-    if (base == "gu") {
-        switch (v) {
-            case 'a': return "gwa";
-            case 'i': return "gwi";
-            case 'e': return "gwe";
-            case 'o': return "gwo";
-            default: break;
-        }
-    }
-    return "";
-}
-
-static std::vector<uint32_t> decodeUtf8(const std::string& text, bool& hasKana, bool& hasKanji) {
-    std::vector<uint32_t> codepoints;
-    hasKana = false;
-    hasKanji = false;
-    for (size_t i = 0; i < text.size();) {
-        const unsigned char c = static_cast<unsigned char>(text[i]);
-        if (c < 0x80) {
-            codepoints.push_back(c);
-            ++i;
-            continue;
-        }
-
-        uint32_t codepoint = 0;
-        size_t extraBytes = 0;
-        if ((c & 0xE0) == 0xC0 && i + 1 < text.size()) {
-            codepoint = ((c & 0x1F) << 6) | (static_cast<unsigned char>(text[i + 1]) & 0x3F);
-            extraBytes = 1;
-        } else if ((c & 0xF0) == 0xE0 && i + 2 < text.size()) {
-            codepoint = ((c & 0x0F) << 12)
-                | ((static_cast<unsigned char>(text[i + 1]) & 0x3F) << 6)
-                | (static_cast<unsigned char>(text[i + 2]) & 0x3F);
-            extraBytes = 2;
-        } else if ((c & 0xF8) == 0xF0 && i + 3 < text.size()) {
-            codepoint = ((c & 0x07) << 18)
-                | ((static_cast<unsigned char>(text[i + 1]) & 0x3F) << 12)
-                | ((static_cast<unsigned char>(text[i + 2]) & 0x3F) << 6)
-                | (static_cast<unsigned char>(text[i + 3]) & 0x3F);
-            extraBytes = 3;
-        } else {
-            ++i;
-            continue;
-        }
-
-        codepoints.push_back(codepoint);
-        if (isHiragana(codepoint) || isKatakana(codepoint) || codepoint == 0x30FC) {
-            hasKana = true;
-        } else if (isKanji(codepoint)) {
-            hasKanji = true;
-        }
-        i += extraBytes + 1;
-    }
-
-    return codepoints;
-}
-
-static std::thread::id mainThreadId;
-
-static void captureMainThreadId() {
-    if (mainThreadId == std::thread::id()) {
-        mainThreadId = std::this_thread::get_id();
-    }
-}
-
-static bool isOnMainThread() {
-    return mainThreadId != std::thread::id() && std::this_thread::get_id() == mainThreadId;
-}
-
-static std::once_flag romajiOverridesInitFlag;
-static std::vector<std::pair<std::string, std::string>> romajiOverrides;
-
-static std::string trimAscii(const std::string& text) {
-    size_t start = 0;
-    while (start < text.size() && std::isspace(static_cast<unsigned char>(text[start]))) {
-        ++start;
-    }
-    if (start >= text.size()) {
-        return "";
-    }
-    size_t end = text.size() - 1;
-    while (end > start && std::isspace(static_cast<unsigned char>(text[end]))) {
-        --end;
-    }
-    return text.substr(start, end - start + 1);
-}
-
-static void loadRomajiOverrides() {
-    std::call_once(romajiOverridesInitFlag, []() {
-        const std::filesystem::path overridePath = AirbudsSearch::getDataDirectory() / "romaji_overrides.txt";
-        if (!std::filesystem::exists(overridePath)) {
-            return;
-        }
-        std::ifstream file(overridePath, std::ios::binary);
-        if (!file.is_open()) {
-            AirbudsSearch::Log.warn("Romaji overrides file could not be opened: {}", overridePath.string());
-            return;
-        }
-
-        std::string line;
-        while (std::getline(file, line)) {
-            if (!line.empty() && line.back() == '\r') {
-                line.pop_back();
-            }
-            const std::string trimmed = trimAscii(line);
-            if (trimmed.empty() || trimmed.front() == '#') {
-                continue;
-            }
-            size_t delimiter = trimmed.find('=');
-            if (delimiter == std::string::npos) {
-                delimiter = trimmed.find('\t');
-            }
-            if (delimiter == std::string::npos) {
-                continue;
-            }
-            std::string source = trimAscii(trimmed.substr(0, delimiter));
-            std::string romaji = trimAscii(trimmed.substr(delimiter + 1));
-            if (source.empty() || romaji.empty()) {
-                continue;
-            }
-            romajiOverrides.emplace_back(std::move(source), std::move(romaji));
-        }
-
-        if (!romajiOverrides.empty()) {
-            std::sort(romajiOverrides.begin(), romajiOverrides.end(),
-                [](const auto& left, const auto& right) {
-                    return left.first.size() > right.first.size();
-                });
-            AirbudsSearch::Log.info("Loaded {} romaji overrides from {}", romajiOverrides.size(), overridePath.string());
-        } else {
-            AirbudsSearch::Log.warn("Romaji overrides file is empty: {}", overridePath.string());
-        }
-    });
-}
-
-static std::string applyRomajiOverrides(const std::string& text) {
-    loadRomajiOverrides();
-    if (romajiOverrides.empty() || text.empty()) {
-        return text;
-    }
-
-    std::string output = text;
-    for (const auto& entry : romajiOverrides) {
-        const std::string& needle = entry.first;
-        const std::string& replacement = entry.second;
-        if (needle.empty()) {
-            continue;
-        }
-        size_t pos = 0;
-        while ((pos = output.find(needle, pos)) != std::string::npos) {
-            output.replace(pos, needle.size(), replacement);
-            pos += replacement.size();
-        }
-    }
-    return output;
-}
-
-static std::once_flag converterInitFlag;
-static const AirbudsSearch::IJapaneseConverter* externalConverter = nullptr;
-static std::string externalConverterName;
-static std::once_flag converterMissingLogFlag;
-static std::once_flag converterInvalidLogFlag;
-static std::once_flag converterFailureLogFlag;
-
-static const AirbudsSearch::IJapaneseConverter* loadExternalJapaneseConverter() {
-    std::call_once(converterInitFlag, []() {
-        CModInfo modInfo{"airbuds-search-kakasi", "0.0.0", 0};
-        CModResult mod = modloader_get_mod(&modInfo, MatchType_IdOnly);
-        void* symbol = nullptr;
-        if (mod.handle) {
-            symbol = dlsym(mod.handle, AirbudsSearch::kJapaneseConverterSymbol);
-        }
-        if (!symbol) {
-            symbol = dlsym(RTLD_DEFAULT, AirbudsSearch::kJapaneseConverterSymbol);
-        }
-        if (!symbol) {
-            std::call_once(converterMissingLogFlag, []() {
-                AirbudsSearch::Log.info("Japanese converter mod not found; romaji will be kana-only.");
-            });
-            return;
-        }
-
-        auto getConverter = reinterpret_cast<AirbudsSearch::GetJapaneseConverterFn>(symbol);
-        const AirbudsSearch::IJapaneseConverter* converter = getConverter ? getConverter() : nullptr;
-        if (!converter || converter->apiVersion != 1 || !converter->convert) {
-            std::call_once(converterInvalidLogFlag, []() {
-                AirbudsSearch::Log.warn("Japanese converter API mismatch; romaji will be kana-only.");
-            });
-            return;
-        }
-
-        externalConverter = converter;
-        externalConverterName = converter->name ? converter->name : "unknown";
-        AirbudsSearch::Log.info("Japanese converter loaded: {}", externalConverterName);
-    });
-    return externalConverter;
-}
-
-static std::string romanizeWithExternalConverter(const std::string& text) {
-    const AirbudsSearch::IJapaneseConverter* converter = loadExternalJapaneseConverter();
-    if (!converter || text.empty()) {
-        return "";
-    }
-
-    std::string output;
-    output.resize(text.size() * 4 + 32);
-    if (!converter->convert(text.c_str(), output.data(), output.size())) {
-        std::call_once(converterFailureLogFlag, []() {
-            AirbudsSearch::Log.warn("Japanese converter failed to convert text.");
-        });
-        return "";
-    }
-
-    output.resize(std::strlen(output.c_str()));
-    return output;
-}
-
-static std::string normalizeRomajiAscii(const std::string& text) {
-    std::string normalized;
-    normalized.reserve(text.size());
-    for (unsigned char c : text) {
-        if (std::isalnum(c)) {
-            normalized.push_back(static_cast<char>(std::tolower(c)));
-        }
-    }
-    return normalized;
-}
-
-static std::string romanizeKanaOnly(const std::vector<uint32_t>& codepoints) {
-    std::string output;
-    bool doubleConsonant = false;
-
-    for (size_t i = 0; i < codepoints.size(); ++i) {
-        uint32_t codepoint = codepoints[i];
-
-        if (codepoint <= 0x7F) {
-            output.push_back(static_cast<char>(codepoint));
-            continue;
-        }
-
-        if (codepoint == 0x3000 || codepoint == 0x30FB) {
-            appendSpaceIfNeeded(output);
-            continue;
-        }
-
-        if (codepoint == 0x30FC) {
-            const char vowel = getLastVowel(output);
-            if (vowel != '\0') {
-                output.push_back(vowel);
-            }
-            continue;
-        }
-
-        if (isKatakana(codepoint)) {
-            codepoint = toHiragana(codepoint);
-        }
-
-        if (isHiragana(codepoint)) {
-            if (codepoint == 0x3063) {
-                doubleConsonant = true;
-                continue;
-            }
-
-            uint32_t nextCodepoint = 0;
-            if (i + 1 < codepoints.size()) {
-                nextCodepoint = codepoints[i + 1];
-                if (isKatakana(nextCodepoint)) {
-                    nextCodepoint = toHiragana(nextCodepoint);
-                }
-            }
-
-            const std::string base = kanaToRomaji(codepoint);
-            if (!base.empty()) {
-                if (isSmallY(nextCodepoint)) {
-                    std::string combined = combineYoon(base, nextCodepoint);
-                    if (!combined.empty()) {
-                        if (doubleConsonant) {
-                            combined = doubleLeadingConsonant(combined);
-                        }
-                        output += combined;
-                        doubleConsonant = false;
-                        ++i;
-                        continue;
-                    }
-                }
-
-                if (isSmallVowel(nextCodepoint)) {
-                    std::string combined = combineSmallVowel(base, nextCodepoint);
-                    if (!combined.empty()) {
-                        if (doubleConsonant) {
-                            combined = doubleLeadingConsonant(combined);
-                        }
-                        output += combined;
-                        doubleConsonant = false;
-                        ++i;
-                        continue;
-                    }
-                }
-
-                std::string romaji = base;
-                if (doubleConsonant) {
-                    romaji = doubleLeadingConsonant(romaji);
-                }
-                output += romaji;
-                doubleConsonant = false;
-                continue;
-            }
-
-            if (isSmallVowel(codepoint)) {
-                const char* vowel = getSmallVowelRomaji(codepoint);
-                if (vowel[0] != '\0') {
-                    output += vowel;
-                }
-                continue;
-            }
-
-            if (isSmallY(codepoint)) {
-                const char* y = getSmallYRomaji(codepoint);
-                if (y[0] != '\0') {
-                    output += y;
-                }
-                continue;
-            }
-
-            appendSpaceIfNeeded(output);
-            doubleConsonant = false;
-            continue;
-        }
-
-        appendSpaceIfNeeded(output);
-    }
-
-    return output;
-}
-
-static std::string romanizeJapaneseSegment(
-    const std::string& text,
-    const std::vector<uint32_t>& codepoints,
-    const bool hasKana,
-    const bool hasKanji) {
-    if (hasKanji) {
-        const std::string romaji = romanizeWithExternalConverter(text);
-        if (!romaji.empty()) {
-            if (hasKana) {
-                const std::string kanaOnly = romanizeKanaOnly(codepoints);
-                if (!kanaOnly.empty()
-                    && normalizeRomajiAscii(romaji) == normalizeRomajiAscii(kanaOnly)) {
-                    return "";
-                }
-            }
-            return romaji;
-        }
-        if (hasKana) {
-            return romanizeKanaOnly(codepoints);
-        }
-        return "";
-    }
-    if (!hasKana) {
-        return "";
-    }
-    return romanizeKanaOnly(codepoints);
-}
-
-static std::string romanizeJapanese(const std::string& text) {
-    const std::string input = applyRomajiOverrides(text);
-    const bool overridesApplied = input != text;
-    bool hasKana = false;
-    bool hasKanji = false;
-    const std::vector<uint32_t> codepoints = decodeUtf8(input, hasKana, hasKanji);
-    if (!hasKana && !hasKanji) {
-        if (!overridesApplied) {
-            return "";
-        }
-        std::string output;
-        output.reserve(input.size());
-        for (unsigned char c : input) {
-            if (std::isalnum(c)) {
-                output.push_back(static_cast<char>(std::tolower(c)));
-            } else {
-                appendSpaceIfNeeded(output);
-            }
-        }
-        if (!output.empty() && output.back() == ' ') {
-            output.pop_back();
-        }
-        return output;
-    }
-
-    std::string output;
-    std::string jpSegment;
-    std::vector<uint32_t> jpCodepoints;
-    bool segmentHasKana = false;
-    bool segmentHasKanji = false;
-
-    auto flushSegment = [&]() {
-        if (jpSegment.empty()) {
-            return;
-        }
-        const std::string romaji = romanizeJapaneseSegment(jpSegment, jpCodepoints, segmentHasKana, segmentHasKanji);
-        if (!romaji.empty()) {
-            appendSpaceIfNeeded(output);
-            output += romaji;
-        }
-        jpSegment.clear();
-        jpCodepoints.clear();
-        segmentHasKana = false;
-        segmentHasKanji = false;
-    };
-
-    for (const uint32_t codepoint : codepoints) {
-        if (isJapaneseCodepoint(codepoint)) {
-            appendUtf8(jpSegment, codepoint);
-            jpCodepoints.push_back(codepoint);
-            if (isKanji(codepoint)) {
-                segmentHasKanji = true;
-            } else if (isHiragana(codepoint) || isKatakana(codepoint)) {
-                segmentHasKana = true;
-            }
-            continue;
-        }
-
-        flushSegment();
-
-        if (codepoint <= 0x7F) {
-            const unsigned char ascii = static_cast<unsigned char>(codepoint);
-            if (std::isalnum(ascii)) {
-                output.push_back(static_cast<char>(std::tolower(ascii)));
-            } else {
-                appendSpaceIfNeeded(output);
-            }
-            continue;
-        }
-
-        appendSpaceIfNeeded(output);
-    }
-
-    flushSegment();
-    if (!output.empty() && output.back() == ' ') {
-        output.pop_back();
-    }
-
-    return output;
-}
-
-static std::vector<std::string> getWordsWithRomaji(const std::string& text, const std::string& romaji) {
-    std::vector<std::string> words = getWords(text);
-    if (!romaji.empty()) {
-        const std::vector<std::string> romajiWords = getWords(romaji);
-        words.insert(words.end(), romajiWords.begin(), romajiWords.end());
-    }
-    return words;
-}
-
-static std::vector<std::string> getWordsWithRomaji(const std::string& text) {
-    return getWordsWithRomaji(text, romanizeJapanese(text));
-}
-
-static std::string getTrackRomajiCached(const airbuds::Track& track) {
-    if (track.name.empty()) {
-        return "";
-    }
-
-    const std::string key = track.id.empty() ? track.name : track.id;
-    static std::mutex cacheMutex;
-    static std::unordered_map<std::string, std::string> cache;
-
-    {
-        std::lock_guard<std::mutex> lock(cacheMutex);
-        auto it = cache.find(key);
-        if (it != cache.end()) {
-            return it->second;
-        }
-    }
-
-    std::string romaji = romanizeJapanese(track.name);
-    {
-        std::lock_guard<std::mutex> lock(cacheMutex);
-        cache.emplace(key, romaji);
-    }
-
-    return romaji;
-}
-
-struct QuerySpec {
-    std::string query;
-    std::string label;
-    int baseScore = 0;
-};
-
-struct ArtistMatchInfo {
-    std::string name;
-    std::string romaji;
-};
-
-static std::string normalizeQueryWhitespace(const std::string& text) {
-    std::string output;
-    output.reserve(text.size());
-    bool inWhitespace = false;
-    for (unsigned char c : text) {
-        if (std::isspace(c)) {
-            if (!output.empty() && !inWhitespace) {
-                output.push_back(' ');
-                inWhitespace = true;
-            }
-            continue;
-        }
-        output.push_back(static_cast<char>(c));
-        inWhitespace = false;
-    }
-    if (!output.empty() && output.back() == ' ') {
-        output.pop_back();
-    }
-    return output;
-}
-
-static std::string joinWords(const std::vector<std::string>& words) {
-    std::string output;
-    for (const std::string& word : words) {
-        if (word.empty()) {
-            continue;
-        }
-        if (!output.empty()) {
-            output.push_back(' ');
-        }
-        output.append(word);
-    }
-    return normalizeQueryWhitespace(output);
-}
-
-static std::string buildQueryFromText(const std::string& text) {
-    const std::vector<std::string> words = getWords(text);
-    if (words.empty()) {
-        return normalizeQueryWhitespace(text);
-    }
-    return joinWords(words);
-}
-
-static size_t countAsciiAlnum(const std::string& text) {
-    size_t count = 0;
-    for (unsigned char c : text) {
-        if (std::isalnum(c)) {
-            ++count;
-        }
-    }
-    return count;
-}
-
-static bool isUsefulRomajiQuery(const std::string& romajiQuery) {
-    if (romajiQuery.empty()) {
-        return false;
-    }
-    if (romajiQuery.find(' ') != std::string::npos) {
-        return true;
-    }
-    return countAsciiAlnum(romajiQuery) >= 4;
-}
-
-static void addUniqueQuery(std::vector<std::string>& queries, std::unordered_set<std::string>& seen, const std::string& rawQuery) {
-    const std::string normalized = normalizeQueryWhitespace(rawQuery);
-    if (normalized.empty()) {
-        return;
-    }
-    std::string key = normalizeRomajiAscii(normalized);
-    if (key.empty()) {
-        key = normalized;
-    }
-    if (seen.insert(key).second) {
-        queries.push_back(normalized);
-    }
-}
-
-static std::string urlEncodeQuery(std::string_view text) {
-    static constexpr char kHex[] = "0123456789ABCDEF";
-    std::string output;
-    output.reserve(text.size() * 3);
-    for (unsigned char c : text) {
-        if ((c >= 'A' && c <= 'Z')
-            || (c >= 'a' && c <= 'z')
-            || (c >= '0' && c <= '9')
-            || c == '-' || c == '_' || c == '.' || c == '~') {
-            output.push_back(static_cast<char>(c));
-            continue;
-        }
-        output.push_back('%');
-        output.push_back(kHex[(c >> 4) & 0xF]);
-        output.push_back(kHex[c & 0xF]);
-    }
-    return output;
-}
-
-static std::vector<ArtistMatchInfo> buildArtistInfos(const std::vector<airbuds::Artist>& artists) {
-    std::vector<ArtistMatchInfo> infos;
-    infos.reserve(artists.size());
-    for (const airbuds::Artist& artist : artists) {
-        ArtistMatchInfo info;
-        info.name = artist.name;
-        info.romaji = romanizeJapanese(artist.name);
-        infos.push_back(std::move(info));
-    }
-    return infos;
-}
-
-static std::string getArtistRomajiLog(const std::vector<ArtistMatchInfo>& infos) {
-    std::string output;
-    for (const auto& info : infos) {
-        if (info.romaji.empty()) {
-            continue;
-        }
-        if (!output.empty()) {
-            output += ", ";
-        }
-        output += info.romaji;
-    }
-    return output;
-}
-
-static void addQuerySpec(
-    std::vector<QuerySpec>& queries,
-    std::unordered_map<std::string, size_t>& seen,
-    const std::string& rawQuery,
-    std::string_view label,
-    int baseScore) {
-    const std::string normalized = normalizeQueryWhitespace(rawQuery);
-    if (normalized.empty()) {
-        return;
-    }
-    std::string key = normalizeRomajiAscii(normalized);
-    if (key.empty()) {
-        key = normalized;
-    }
-    auto it = seen.find(key);
-    if (it != seen.end()) {
-        QuerySpec& existing = queries[it->second];
-        if (baseScore > existing.baseScore) {
-            existing.baseScore = baseScore;
-            existing.label = std::string(label);
-        }
-        return;
-    }
-    QuerySpec spec;
-    spec.query = normalized;
-    spec.label = std::string(label);
-    spec.baseScore = baseScore;
-    seen.emplace(key, queries.size());
-    queries.push_back(std::move(spec));
-}
-
-static std::vector<QuerySpec> buildBeatSaverQueries(const airbuds::Track& track, const std::vector<ArtistMatchInfo>& artistInfos) {
-    std::vector<QuerySpec> queries;
-    std::unordered_map<std::string, size_t> seen;
-
-    const std::string nameQuery = buildQueryFromText(track.name);
-    addQuerySpec(queries, seen, nameQuery, "name", 1500);
-
-    std::string artistQuery;
-    std::string artistRomajiQuery;
-    if (!artistInfos.empty()) {
-        artistQuery = buildQueryFromText(artistInfos.front().name);
-        artistRomajiQuery = buildQueryFromText(artistInfos.front().romaji);
-    }
-    if (!nameQuery.empty() && !artistQuery.empty()) {
-        addQuerySpec(queries, seen, std::format("{} {}", nameQuery, artistQuery), "name+artist", 2000);
-    }
-    if (!nameQuery.empty()
-        && isUsefulRomajiQuery(artistRomajiQuery)
-        && normalizeRomajiAscii(artistRomajiQuery) != normalizeRomajiAscii(artistQuery)) {
-        addQuerySpec(queries, seen, std::format("{} {}", nameQuery, artistRomajiQuery), "name+artistRomaji", 1800);
-    }
-
-    const std::string romaji = getTrackRomajiCached(track);
-    const std::string romajiQuery = buildQueryFromText(romaji);
-    if (isUsefulRomajiQuery(romajiQuery)
-        && normalizeRomajiAscii(romajiQuery) != normalizeRomajiAscii(nameQuery)) {
-        addQuerySpec(queries, seen, romajiQuery, "romaji", 1200);
-        if (!artistQuery.empty()) {
-            addQuerySpec(queries, seen, std::format("{} {}", romajiQuery, artistQuery), "romaji+artist", 1400);
-        }
-        if (!artistRomajiQuery.empty()) {
-            addQuerySpec(queries, seen, std::format("{} {}", romajiQuery, artistRomajiQuery), "romaji+artistRomaji", 1300);
-        }
-    }
-
-    std::stable_sort(queries.begin(), queries.end(), [](const QuerySpec& a, const QuerySpec& b) {
-        return a.baseScore > b.baseScore;
-    });
-
-    return queries;
-}
-
-static int scoreTextMatch(const std::string& needle, const std::string& haystack) {
-    if (needle.empty() || haystack.empty()) {
-        return 0;
-    }
-    auto equalsIgnoreCase = [](unsigned char c1, unsigned char c2) {
-        return std::tolower(c1) == std::tolower(c2);
-    };
-    if (std::ranges::equal(needle, haystack, equalsIgnoreCase)) {
-        return 800;
-    }
-
-    const std::vector<std::string> needleWords = getWords(needle);
-    const std::vector<std::string> haystackWords = getWords(haystack);
-    if (needleWords.empty() || haystackWords.empty()) {
-        return 0;
-    }
-
-    std::unordered_set<std::string> haystackSet(haystackWords.begin(), haystackWords.end());
-    int score = 0;
-    for (const std::string& word : needleWords) {
-        if (word.empty()) {
-            continue;
-        }
-        if (haystackSet.contains(word)) {
-            score += 40 + static_cast<int>(std::min<size_t>(word.size(), 8)) * 5;
-        }
-    }
-    return score;
-}
-
-static bool beatmapHasDifficulty(const BeatSaver::Models::BeatmapVersion& version, const std::vector<SongDetailsCache::MapDifficulty>& difficulties) {
-    if (difficulties.empty()) {
-        return false;
-    }
-    for (const BeatSaver::Models::BeatmapDifficulty& diff : version.Diffs) {
-        const std::string diffName = AirbudsSearch::Utils::toLowerCase(diff.Difficulty);
-        for (const SongDetailsCache::MapDifficulty desired : difficulties) {
-            switch (desired) {
-                case SongDetailsCache::MapDifficulty::Easy:
-                    if (diffName == "easy") return true;
-                    break;
-                case SongDetailsCache::MapDifficulty::Normal:
-                    if (diffName == "normal") return true;
-                    break;
-                case SongDetailsCache::MapDifficulty::Hard:
-                    if (diffName == "hard") return true;
-                    break;
-                case SongDetailsCache::MapDifficulty::Expert:
-                    if (diffName == "expert") return true;
-                    break;
-                case SongDetailsCache::MapDifficulty::ExpertPlus:
-                    if (diffName == "expertplus" || diffName == "expert+") return true;
-                    break;
-                default:
-                    break;
-            }
-        }
-    }
-    return false;
-}
-
-static int scoreBeatSaverCandidate(
-    const airbuds::Track& track,
-    const std::string& trackRomaji,
-    const std::vector<ArtistMatchInfo>& artistInfos,
-    const BeatSaver::Models::Beatmap& beatmap,
-    bool artistBoost,
-    bool difficultyBonus) {
-    int score = 0;
-
-    const auto& metadata = beatmap.Metadata;
-    const std::string& songName = metadata.SongName;
-    const std::string& songAuthor = metadata.SongAuthorName;
-    const std::string& levelAuthor = metadata.LevelAuthorName;
-
-    int nameScore = std::max(scoreTextMatch(track.name, songName), scoreTextMatch(track.name, beatmap.Name));
-    if (!trackRomaji.empty()) {
-        const std::string songNameRomaji = romanizeJapanese(songName);
-        nameScore = std::max(nameScore, scoreTextMatch(trackRomaji, songName));
-        if (!songNameRomaji.empty()) {
-            nameScore = std::max(nameScore, scoreTextMatch(trackRomaji, songNameRomaji));
-        }
-    }
-    score += nameScore * 2;
-
-    int artistScore = 0;
-    for (const auto& artist : artistInfos) {
-        artistScore = std::max(artistScore, scoreTextMatch(artist.name, songAuthor));
-        artistScore = std::max(artistScore, scoreTextMatch(artist.name, levelAuthor));
-        if (!artist.romaji.empty()) {
-            artistScore = std::max(artistScore, scoreTextMatch(artist.romaji, songAuthor));
-            artistScore = std::max(artistScore, scoreTextMatch(artist.romaji, levelAuthor));
-        }
-    }
-    score += artistScore;
-    if (artistBoost && artistScore > 0) {
-        score += 200;
-    }
-
-    if (difficultyBonus) {
-        score += 25;
-    }
-
-    if (beatmap.Stats.Score > 0.0f) {
-        score += std::clamp(static_cast<int>(beatmap.Stats.Score * 10.0f), 0, 50);
-    }
-
-    return score;
-}
-
-SongFilterFunction DEFAULT_SONG_FILTER_FUNCTION = [](const SongDetailsCache::Song* const song, const airbuds::Track& track) {
-    // Remove songs that don't have at least one word from the Airbuds track in the name
-    const std::string romajiTrackName = getTrackRomajiCached(track);
-    const std::vector<std::string> wordsInTrackName = getWordsWithRomaji(track.name, romajiTrackName);
-    const std::vector<std::string> wordsInSongName = getWords(song->songName());
-
-    bool didMatchAtLeastOneWordFromSongName = false;
-    for (const std::string& word : wordsInTrackName) {
-        if (std::ranges::find(wordsInSongName, word) != wordsInSongName.end()) {
-            didMatchAtLeastOneWordFromSongName = true;
-        }
-    }
-
-    return didMatchAtLeastOneWordFromSongName;
-};
-
-SongScoreFunction DEFAULT_SONG_SCORE_FUNCTION = [](const airbuds::Track& track, const SongDetailsCache::Song& song) {
-    int score = 0;
-
-    // Song name
-    const std::string romajiTrackName = getTrackRomajiCached(track);
-    auto equalsIgnoreCase = [](unsigned char c1, unsigned char c2) {
-        return std::tolower(c1) == std::tolower(c2);
-    };
-
-    if (std::ranges::equal(
-            song.songName(), track.name,
-            equalsIgnoreCase)
-        || (!romajiTrackName.empty() && std::ranges::equal(song.songName(), romajiTrackName, equalsIgnoreCase))) {
-        score += 1000;
-    } else {
-        const std::vector<std::string> wordsInTrackName = getWordsWithRomaji(track.name, romajiTrackName);
-        const std::vector<std::string> wordsInSongName = getWords(song.songName());
-
-        // One point for every word in the song name
-        for (const std::string& word : wordsInTrackName) {
-            if (std::ranges::find(wordsInSongName, word) != wordsInSongName.end()) {
-                score += (100.0f * ((float) word.size() / (float) 10));
-            }
-        }
-    }
-
-    // Song artists
-    const std::string songArtistLowercase = AirbudsSearch::Utils::toLowerCase(song.songAuthorName());
-    std::vector<std::string> trackArtists;
-    for (const airbuds::Artist& artist : track.artists) {
-        const std::string artistNameLowercase = AirbudsSearch::Utils::toLowerCase(artist.name);
-        if (songArtistLowercase.contains(artistNameLowercase)) {
-            score += 100;
-        }
-    }
-
-    // Increase score based on upvotes
-    score += std::min(80, static_cast<int>((float) song.upvotes / (float) 10));
-
-    // Decrease score based on downvotes
-    score -= std::min(80, static_cast<int>((float) song.downvotes / 5));
-
-    return score;
-};
-
-} // namespace AirbudsSearch::Filter
+// Number of results shown while a progressive search is still waiting for some of its queries
+static constexpr size_t PROGRESSIVE_RESULT_COUNT = 20;
 
 namespace {
 
@@ -1347,6 +122,13 @@ void MainViewController::DidActivate(const bool isFirstActivation, const bool ad
     if (!isFirstActivation && !selectedPlaylist_ && !isLoadingMoreAirbudsPlaylists_) {
         reloadAirbudsPlaylistListView();
     }
+
+    AirbudsSearch::SearchPrefetcher::getInstance().setActive(true);
+}
+
+void MainViewController::DidDeactivate(const bool removedFromHierarchy, const bool screenSystemDisabling) {
+    // Don't use the network while the user is playing a level or somewhere else in the menus
+    AirbudsSearch::SearchPrefetcher::getInstance().setActive(false);
 }
 
 void MainViewController::onTrackLoadError(const std::string& message) {
@@ -1599,7 +381,7 @@ void MainViewController::PostParse() {
     airbudsListViewStatusContainer_->get_gameObject()->set_active(false);
 
     searchResultsListViewErrorContainer_->get_gameObject()->set_active(false);
-    if (isSearchInProgress_) {
+    if (isSearchInProgress_ && !hasPublishedSearchResults_) {
         searchResultsListLoadingIndicatorContainer_->get_gameObject()->set_active(true);
     } else {
         searchResultsListLoadingIndicatorContainer_->get_gameObject()->set_active(false);
@@ -1789,6 +571,7 @@ void MainViewController::setHistoryFriend(const std::optional<airbuds::Friend>&
     selectedFriend_ = friendUser;
     selectedPlaylist_.reset();
     selectedTrack_.reset();
+    cancelSongSearch();
     pendingRandomTrack_.reset();
 
     if (airbudsPlaylistListView_) {
@@ -1829,18 +612,21 @@ void MainViewController::setHistoryFriend(const std::optional<airbuds::Friend>&
 void MainViewController::ctor() {
     previewSong_ = nullptr;
     selectedPlaylist_ = nullptr;
+    selectedTrackRow_ = -1;
     isDownloadThreadRunning_ = false;
     isLoadingMoreAirbudsTracks_ = false;
     isLoadingMoreAirbudsPlaylists_ = false;
     isShowingAllTracksByArtist_ = false;
     isShowingDownloadedMaps_ = true;
+    hasPublishedSearchResults_ = false;
+    publishedPartialResultSequence_ = 0;
+    searchGeneration_ = 0;
+    searchCancellationToken_ = AirbudsSearch::CancellationToken();
     customSongFilter_ = CustomSongFilter();
     customSongFilter_.includeDownloadedSongs_ = true;
     randomAcrossAllDays_ = false;
     pendingRandomTrack_.reset();
     selectedFriend_.reset();
-    currentSongFilter_ = AirbudsSearch::Filter::DEFAULT_SONG_FILTER_FUNCTION;
-    currentSongScore_ = AirbudsSearch::Filter::DEFAULT_SONG_SCORE_FUNCTION;
     AirbudsSearch::Log.info("MainViewController::ctor() called, isShowingDownloadedMaps_={}, customSongFilter_.includeDownloadedSongs_={}", isShowingDownloadedMaps_.load(), customSongFilter_.includeDownloadedSongs_);
 }
 
@@ -1905,11 +691,16 @@ void MainViewController::onAirbudsTrackLoadingError(const std::string& message)
 void MainViewController::reloadAirbudsPlaylistListView() {
     airbudsListViewStatusContainer_->get_gameObject()->set_active(false);
 
-    showAirbudsTrackLoadingIndicator();
     auto* playlistTableViewDataSource = gameObject->GetComponent<AirbudsPlaylistTableViewDataSource*>();
     const std::optional<std::string> friendId = getSelectedFriendId();
+
+    // A friend history that was just refreshed in the background is shown from the cache, without a loading indicator
+    const bool isFresh = friendId && AirbudsSearch::airbudsClient && AirbudsSearch::airbudsClient->isRecentlyPlayedFreshForUser(*friendId);
+    if (!isFresh) {
+        showAirbudsTrackLoadingIndicator();
+    }
     isLoadingMoreAirbudsPlaylists_ = true;
-    std::thread([this, playlistTableViewDataSource, friendId]() {
+    std::thread([this, playlistTableViewDataSource, friendId, isFresh]() {
         // Make sure the Airbuds client is still valid
         if (!AirbudsSearch::airbudsClient) {
             isLoadingMoreAirbudsPlaylists_ = false;
@@ -1921,7 +712,9 @@ void MainViewController::reloadAirbudsPlaylistListView() {
         std::vector<airbuds::Playlist> playlists;
         std::string statusMessage;
         try {
-            if (friendId) {
+            if (isFresh) {
+                playlists = airbudsClient->getPlaylistsCachedOnlyForUser(*friendId);
+            } else if (friendId) {
                 playlists = airbudsClient->getPlaylistsForUser(*friendId);
             } else {
                 playlists = airbudsClient->getPlaylists();
@@ -1958,7 +751,7 @@ void MainViewController::reloadAirbudsPlaylistListView() {
             }
         }
 
-        if (statusMessage.empty() && AirbudsSearch::airbudsClient) {
+        if (statusMessage.empty() && !isFresh && AirbudsSearch::airbudsClient) {
             const std::string warning = AirbudsSearch::airbudsClient->getLastRecentlyPlayedWarning();
             if (!warning.empty()) {
                 statusMessage = warning;
@@ -2004,6 +797,7 @@ void MainViewController::reloadAirbudsPlaylistListView() {
 void MainViewController::onPlaylistsMenuButtonClicked() {
     selectedPlaylist_ = nullptr;
     selectedTrack_ = nullptr;
+    cancelSongSearch();
 
     // Hide tracks list
     airbudsTrackListView_->get_gameObject()->set_active(false);
@@ -2208,17 +1002,6 @@ void MainViewController::setSelectedSongUi(const SongDetailsCache::Song* const s
 
 void MainViewController::doSongSearch(const airbuds::Track& track) {
     AirbudsSearch::Filter::captureMainThreadId();
-    const std::string romaji = AirbudsSearch::Filter::getTrackRomajiCached(track);
-    const std::vector<AirbudsSearch::Filter::ArtistMatchInfo> artistInfos = AirbudsSearch::Filter::buildArtistInfos(track.artists);
-    const std::string artistsRomaji = AirbudsSearch::Filter::getArtistRomajiLog(artistInfos);
-    const std::vector<AirbudsSearch::Filter::QuerySpec> queries = AirbudsSearch::Filter::buildBeatSaverQueries(track, artistInfos);
-    std::string artistNames;
-    for (size_t i = 0; i < track.artists.size(); ++i) {
-        if (i > 0) {
-            artistNames += ", ";
-        }
-        artistNames += track.artists[i].name;
-    }
     auto difficultyToString = [](SongDetailsCache::MapDifficulty diff) {
         switch (diff) {
             case SongDetailsCache::MapDifficulty::Easy:
@@ -2242,25 +1025,6 @@ void MainViewController::doSongSearch(const airbuds::Track& track) {
         }
         difficultyList += difficultyToString(customSongFilter_.difficulties_[i]);
     }
-    AirbudsSearch::Log.info(
-        "Searching for track: id={} name=\"{}\" artists=\"{}\" artistsRomaji=\"{}\" romaji=\"{}\"",
-        track.id,
-        track.name,
-        artistNames,
-        artistsRomaji,
-        romaji);
-    if (queries.empty()) {
-        AirbudsSearch::Log.warn("BeatSaver search skipped: no query terms available.");
-    } else {
-        std::string queryLog;
-        for (size_t i = 0; i < queries.size(); ++i) {
-            if (i > 0) {
-                queryLog += " | ";
-            }
-            queryLog += std::format("[{}:{}] {}", queries[i].label, queries[i].baseScore, queries[i].query);
-        }
-        AirbudsSearch::Log.info("BeatSaver search queries: {}", queryLog);
-    }
     AirbudsSearch::Log.info(
         "Search filter: difficulties=[{}] includeDownloaded={}",
         difficultyList,
@@ -2271,216 +1035,200 @@ void MainViewController::doSongSearch(const airbuds::Track& track) {
     searchResultsList_->get_gameObject()->set_active(false);
     searchResultsListViewErrorContainer_->get_gameObject()->set_active(false);
 
-    isSearchInProgress_ = true;
-    const CustomSongFilter customSongFilter = customSongFilter_;
-    const bool applyArtistBoost = isShowingAllTracksByArtist_;
-    std::thread([this, track, romaji, artistInfos, customSongFilter, applyArtistBoost, queries]() {
-        SongDetailsCache::SongDetails* songDetails = SongDetailsCache::SongDetails::Init().get();
-        if (!songDetails) {
-            AirbudsSearch::Log.warn("SongDetails cache is not available yet.");
-        }
+    // Stop the previous search, its results would be thrown away anyway
+    cancelSongSearch();
+    const AirbudsSearch::CancellationToken cancellationToken = searchCancellationToken_;
 
-        const auto searchStartTime = std::chrono::high_resolution_clock::now();
-        struct Candidate {
-            const SongDetailsCache::Song* song = nullptr;
-            int score = 0;
-            int rank = 0;
-        };
-        std::unordered_map<std::string, Candidate> candidates;
-        size_t missingInCache = 0;
-        size_t duplicateHashes = 0;
-        size_t filteredDownloaded = 0;
-        size_t mappedByHash = 0;
-        size_t mappedByKey = 0;
-        size_t mappedById = 0;
-        size_t difficultyBonusCount = 0;
-        bool hadAnySuccess = false;
-        bool hadAnyFailure = false;
-        size_t totalDocs = 0;
-
-        for (size_t queryIndex = 0; queryIndex < queries.size(); ++queryIndex) {
-            const auto& spec = queries[queryIndex];
-            const int page = 0;
-            const std::string encodedQuery = AirbudsSearch::Filter::urlEncodeQuery(spec.query);
-            const std::string url = std::format(BEATSAVER_API_URL "/search/text/{}?q={}&sortOrder=Relevance", page, encodedQuery);
-            WebUtils::URLOptions urlOptions(url);
-            urlOptions.noEscape = true;
-            AirbudsSearch::Log.info(
-                "BeatSaver request: Search url={} label={} query=\"{}\" encoded=\"{}\"",
-                urlOptions.fullURl(),
-                spec.label,
-                spec.query,
-                encodedQuery);
-            auto response = WebUtils::Get<BeatSaver::API::SearchPageResponse>(urlOptions);
-            AirbudsSearch::Log.info(
-                "BeatSaver response: Search http={} curl={} parsed={} hasData={}",
-                response.get_HttpCode(),
-                response.get_CurlStatus(),
-                response.DataParsedSuccessful(),
-                response.responseData.has_value());
-
-            if (!response.IsSuccessful() || !response.responseData) {
-                hadAnyFailure = true;
-                continue;
+    isSearchInProgress_ = true;
+    hasPublishedSearchResults_ = false;
+    publishedPartialResultSequence_ = 0;
+    const uint64_t searchGeneration = ++searchGeneration_;
+    AirbudsSearch::TrackMatcher::Options options;
+    options.difficulties = customSongFilter_.difficulties_;
+    options.includeDownloadedSongs = customSongFilter_.includeDownloadedSongs_;
+    options.artistBoost = isShowingAllTracksByArtist_;
+    options.onlineSearch = AirbudsSearch::isOnlineSearchEnabled();
+    const bool progressiveResults = AirbudsSearch::isProgressiveSearchEnabled();
+    std::thread([this, track, options, searchGeneration, progressiveResults, cancellationToken]() {
+        const AirbudsSearch::ForegroundSearchScope foregroundSearchScope;
+
+        const auto toSongs = [](const std::vector<AirbudsSearch::TrackMatcher::Match>& matches) {
+            std::vector<const SongDetailsCache::Song*> songs;
+            songs.reserve(matches.size());
+            for (const AirbudsSearch::TrackMatcher::Match& match : matches) {
+                songs.push_back(match.song);
             }
+            return songs;
+        };
 
-            hadAnySuccess = true;
-            const auto& docs = response.responseData->Docs;
-            totalDocs += docs.size();
-            AirbudsSearch::Log.info("BeatSaver search results: query=\"{}\" count={}", spec.query, docs.size());
-            for (size_t docIndex = 0; docIndex < docs.size(); ++docIndex) {
-                const BeatSaver::Models::Beatmap& beatmap = docs[docIndex];
-                const auto versions = beatmap.Versions;
-                if (versions.empty()) {
-                    continue;
-                }
-                const BeatSaver::Models::BeatmapVersion& version = versions.front();
-                const std::string versionHash = version.Hash;
-
-                const SongDetailsCache::Song* song = nullptr;
-                bool mapped = false;
-                if (songDetails && songDetails->songs.FindByHash(versionHash, song) && song) {
-                    mapped = true;
-                    ++mappedByHash;
-                } else if (songDetails) {
-                    if (version.Key && songDetails->songs.FindByMapId(*version.Key, song) && song) {
-                        mapped = true;
-                        ++mappedByKey;
-                    } else if (!beatmap.Id.empty() && songDetails->songs.FindByMapId(beatmap.Id, song) && song) {
-                        mapped = true;
-                        ++mappedById;
-                    }
-                }
-                if (!mapped || !song) {
-                    ++missingInCache;
-                    continue;
-                }
-
-                const std::string songHash = song->hash();
-                if (!customSongFilter.includeDownloadedSongs_ && SongCore::API::Loading::GetLevelByHash(songHash)) {
-                    ++filteredDownloaded;
-                    continue;
-                }
-
-                const bool hasDifficultyBonus = AirbudsSearch::Filter::beatmapHasDifficulty(version, customSongFilter.difficulties_);
-                if (hasDifficultyBonus) {
-                    ++difficultyBonusCount;
+        // The match index only holds results for the default scoring, which doesn't include the artist boost
+        AirbudsSearch::MatchIndex& matchIndex = AirbudsSearch::MatchIndex::getInstance();
+        const bool canUseMatchIndex = !options.artistBoost;
+        if (canUseMatchIndex) {
+            if (const std::optional<AirbudsSearch::MatchIndex::Entry> entry = matchIndex.get(track.id)) {
+                const std::vector<const SongDetailsCache::Song*> indexedSongs = AirbudsSearch::MatchIndex::resolve(*entry, options);
+                const bool isStale = AirbudsSearch::MatchIndex::isStale(*entry);
+                AirbudsSearch::Log.info("Match index hit: track = {} songs = {} stale = {}", track.id, indexedSongs.size(), isStale);
+                if (!isStale) {
+                    BSML::MainThreadScheduler::Schedule([this, searchGeneration, track, indexedSongs]() {
+                        publishSearchResults(searchGeneration, 0, track, indexedSongs, true, false);
+                    });
+                    return;
                 }
-                const int matchScore = AirbudsSearch::Filter::scoreBeatSaverCandidate(track, romaji, artistInfos, beatmap, applyArtistBoost, hasDifficultyBonus);
-                const int score = spec.baseScore + matchScore - static_cast<int>(docIndex);
-                const int rank = static_cast<int>(queryIndex * 100 + docIndex);
 
-                auto it = candidates.find(songHash);
-                if (it == candidates.end()) {
-                    candidates.emplace(songHash, Candidate{song, score, rank});
-                } else {
-                    ++duplicateHashes;
-                    Candidate& existing = it->second;
-                    if (score > existing.score || (score == existing.score && rank < existing.rank)) {
-                        existing.song = song;
-                        existing.score = score;
-                        existing.rank = rank;
-                    }
+                // Show the old matches while they are refreshed
+                if (!indexedSongs.empty()) {
+                    BSML::MainThreadScheduler::Schedule([this, searchGeneration, track, indexedSongs]() {
+                        publishSearchResults(searchGeneration, 0, track, indexedSongs, false, false);
+                    });
                 }
             }
         }
 
-        std::vector<Candidate> sortedCandidates;
-        sortedCandidates.reserve(candidates.size());
-        for (const auto& [hash, candidate] : candidates) {
-            if (candidate.song) {
-                sortedCandidates.push_back(candidate);
-            }
+        AirbudsSearch::TrackMatcher::PartialResultsCallback onPartialResults;
+        if (progressiveResults) {
+            onPartialResults = [this, searchGeneration, track, &toSongs](const std::vector<AirbudsSearch::TrackMatcher::Match>& matches, const uint64_t sequence) {
+                BSML::MainThreadScheduler::Schedule([this, searchGeneration, sequence, track, songs = toSongs(matches)]() {
+                    publishSearchResults(searchGeneration, sequence, track, songs, false, false);
+                });
+            };
+        }
+        const AirbudsSearch::TrackMatcher::Result result = AirbudsSearch::TrackMatcher::findMatches(
+            track,
+            options,
+            cancellationToken,
+            onPartialResults,
+            PROGRESSIVE_RESULT_COUNT);
+        if (result.cancelled) {
+            return;
         }
 
-        AirbudsSearch::Log.info(
-            "Online search mapped songs = {} candidates={} totalDocs={} missingInCache={} duplicates={} filteredDownloaded={} difficultyBonus={} mappedByHash={} mappedByKey={} mappedById={} time = {} ms.",
-            sortedCandidates.size(),
-            candidates.size(),
-            totalDocs,
-            missingInCache,
-            duplicateHashes,
-            filteredDownloaded,
-            difficultyBonusCount,
-            mappedByHash,
-            mappedByKey,
-            mappedById,
-            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - searchStartTime).count());
-
-        if (hadAnyFailure && !hadAnySuccess) {
-            AirbudsSearch::Log.warn("All BeatSaver search requests failed.");
+        // Only results found with the default filter can be stored, the others would change the stored scores. The
+        // prefetcher writes the index to disk later, together with other new entries.
+        if (canUseMatchIndex && result.hadAnySuccess && options.difficulties.empty() && options.includeDownloadedSongs) {
+            matchIndex.put(track.id, result);
+            AirbudsSearch::SearchPrefetcher::getInstance().addUnsavedIndexEntry();
         }
 
-        // Sort results
-        auto sortStartTime = std::chrono::high_resolution_clock::now();
-        std::stable_sort(sortedCandidates.begin(), sortedCandidates.end(), [](const Candidate& a, const Candidate& b) {
-            if (a.score != b.score) {
-                return a.score > b.score;
-            }
-            return a.rank < b.rank;
+        const std::vector<const SongDetailsCache::Song*> songs = toSongs(result.matches);
+        const bool showSearchError = result.queryCount > 0 && !result.hadAnySuccess;
+        BSML::MainThreadScheduler::Schedule([this, searchGeneration, track, songs, showSearchError]() {
+            publishSearchResults(searchGeneration, 0, track, songs, true, showSearchError);
         });
-        AirbudsSearch::Log.info("Sort time: {} ms.", std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - sortStartTime).count());
+    }).detach();
+}
 
-        std::vector<const SongDetailsCache::Song*> songs;
-        songs.reserve(sortedCandidates.size());
-        for (const Candidate& candidate : sortedCandidates) {
-            songs.push_back(candidate.song);
-        }
+void MainViewController::cancelSongSearch() {
+    searchCancellationToken_.cancel();
+    searchCancellationToken_ = AirbudsSearch::CancellationToken();
+    isSearchInProgress_ = false;
+}
 
-        const size_t previewCount = std::min<size_t>(5, sortedCandidates.size());
-        for (size_t i = 0; i < previewCount; ++i) {
-            const Candidate& candidate = sortedCandidates.at(i);
-            const SongDetailsCache::Song* song = candidate.song;
-            AirbudsSearch::Log.info(
-                "Search result[{}]: score={} name=\"{}\" author=\"{}\" hash={}",
-                i,
-                candidate.score,
-                song->songName(),
-                song->songAuthorName(),
-                song->hash());
+void MainViewController::prefetchNeighbourTracks() {
+    const size_t prefetchCount = AirbudsSearch::getSearchPrefetchCount();
+    if (prefetchCount == 0 || !AirbudsSearch::isOnlineSearchEnabled() || !selectedTrack_) {
+        return;
+    }
+
+    // Make sure the row still shows the selected track, the list might have been reloaded since
+    const AirbudsTrackTableViewDataSource* const trackTableViewDataSource = gameObject->GetComponent<AirbudsTrackTableViewDataSource*>();
+    const airbuds::PlaylistTrack* rowTrack = trackTableViewDataSource->getTrackForRow(selectedTrackRow_);
+    if (!rowTrack || rowTrack->id != selectedTrack_->id) {
+        return;
+    }
+
+    const std::vector<airbuds::PlaylistTrack> neighbourTracks = trackTableViewDataSource->getTracksAroundRow(selectedTrackRow_, prefetchCount);
+    AirbudsSearch::SearchPrefetcher::getInstance().setTracks(std::vector<airbuds::Track>(neighbourTracks.begin(), neighbourTracks.end()));
+}
+
+void MainViewController::publishSearchResults(
+    const uint64_t searchGeneration,
+    const uint64_t partialResultSequence,
+    const airbuds::Track& track,
+    const std::vector<const SongDetailsCache::Song*>& songs,
+    const bool isFinal,
+    const bool showSearchError) {
+    // Check if a newer search has been started since
+    if (searchGeneration != searchGeneration_) {
+        AirbudsSearch::Log.warn("Ignoring search results from an outdated search (track = {})", track.id);
+        return;
+    }
+
+    // Check if the user canceled the selection
+    if (selectedTrack_ == nullptr) {
+        AirbudsSearch::Log.warn("Ignoring search results because the selected track is null!");
+        isSearchInProgress_ = false;
+        return;
+    }
+
+    // Check if the user selected a different track
+    if (*selectedTrack_ != track) {
+        AirbudsSearch::Log.warn("Ignoring search results because the selected track has changed! (requested = {} / current = {})", track.id, selectedTrack_->id);
+        isSearchInProgress_ = false;
+        return;
+    }
+
+    // Partial results are scheduled by whichever search thread produced them, so an older list can arrive after a
+    // newer one. The final results are scheduled after every partial one.
+    if (!isFinal) {
+        if (partialResultSequence < publishedPartialResultSequence_) {
+            return;
         }
+        publishedPartialResultSequence_ = partialResultSequence;
+    }
 
-        const bool showSearchError = !queries.empty() && !hadAnySuccess;
-        BSML::MainThreadScheduler::Schedule([this, track, songs, showSearchError]() {
-            // Check if the user canceled the selection
-            if (selectedTrack_ == nullptr) {
-                AirbudsSearch::Log.warn("Ignoring search results because the selected track is null!");
-                isSearchInProgress_ = false;
-                return;
-            }
+    auto customSongTableViewDataSource = gameObject->GetComponent<CustomSongTableViewDataSource*>();
 
-            // Check if the user selected a different track
-            if (*selectedTrack_ != track) {
-                AirbudsSearch::Log.warn("Ignoring search results because the selected track has changed! (requested = {} / current = {})", track.id, selectedTrack_->id);
-                isSearchInProgress_ = false;
-                return;
+    if (hasPublishedSearchResults_) {
+        // The list is already visible, so update it in place to keep the user's selection and scroll position
+        if (customSongTableViewDataSource->updateSource(songs)) {
+            searchResultItems_ = songs;
+            Utils::reloadDataKeepingPosition(searchResultsList_->tableView);
+            const auto selected = std::ranges::find(searchResultItems_, previewSong_);
+            if (selected != searchResultItems_.end()) {
+                searchResultsList_->tableView->SelectCellWithIdx(static_cast<int>(selected - searchResultItems_.begin()), false);
+            } else {
+                searchResultsList_->tableView->ClearSelection();
             }
+        }
+        if (isFinal) {
+            isSearchInProgress_ = false;
+            prefetchNeighbourTracks();
+        }
+        return;
+    }
 
-            // Update the list view
-            auto customSongTableViewDataSource = gameObject->GetComponent<CustomSongTableViewDataSource*>();
-            customSongTableViewDataSource->setSource(songs);
-            searchResultsList_->tableView->SetDataSource(reinterpret_cast<HMUI::TableView::IDataSource*>(customSongTableViewDataSource), true);
-            searchResultsList_->tableView->ClearSelection();
+    // Keep showing the loading indicator until there is something to show
+    if (songs.empty() && !isFinal) {
+        return;
+    }
+    hasPublishedSearchResults_ = true;
 
-            searchResultsListLoadingIndicatorContainer_->get_gameObject()->set_active(false);
-            searchResultsList_->get_gameObject()->set_active(true);
+    // Update the list view
+    customSongTableViewDataSource->setSource(songs);
+    searchResultsList_->tableView->SetDataSource(reinterpret_cast<HMUI::TableView::IDataSource*>(customSongTableViewDataSource), true);
+    searchResultsList_->tableView->ClearSelection();
 
-            if (songs.empty()) {
-                searchResultsListViewErrorContainer_->get_gameObject()->set_active(true);
-                searchResultsList_->get_gameObject()->set_active(false);
-                searchResultsListStatusTextView_->set_text(showSearchError ? "Search Error" : "No Songs");
-            }
+    searchResultsListLoadingIndicatorContainer_->get_gameObject()->set_active(false);
+    searchResultsList_->get_gameObject()->set_active(true);
 
-            searchResultItems_ = songs;
+    if (songs.empty()) {
+        searchResultsListViewErrorContainer_->get_gameObject()->set_active(true);
+        searchResultsList_->get_gameObject()->set_active(false);
+        searchResultsListStatusTextView_->set_text(showSearchError ? "Search Error" : "No Songs");
+    }
 
-            isSearchInProgress_ = false;
+    searchResultItems_ = songs;
 
-            // Automatically select the first search result
-            if (!searchResultItems_.empty()) {
-                searchResultsList_->tableView->SelectCellWithIdx(0, true);
-            }
-        });
-    }).detach();
+    if (isFinal) {
+        isSearchInProgress_ = false;
+        prefetchNeighbourTracks();
+    }
+
+    // Automatically select the first search result
+    if (!searchResultItems_.empty()) {
+        searchResultsList_->tableView->SelectCellWithIdx(0, true);
+    }
 }
 
 void MainViewController::onTrackSelected(UnityW<HMUI::TableView> table, int id) {
@@ -2494,6 +1242,7 @@ void MainViewController::onTrackSelected(UnityW<HMUI::TableView> table, int id)
         return;
     }
     selectedTrack_ = std::make_unique<const airbuds::Track>(*track);
+    selectedTrackRow_ = id;
 
     // Start search
     AirbudsSearch::Log.info("MainViewController::onTrackSelected() before doSongSearch, isShowingDownloadedMaps_={}, customSongFilter_.includeDownloadedSongs_={}", isShowingDownloadedMaps_.load(), customSongFilter_.includeDownloadedSongs_);
@@ -2692,23 +1441,6 @@ void MainViewController::startDownloadThread() {
     }).detach();
 }
 
-bool containsContiguous(const std::vector<std::string>& haystack, const std::vector<std::string>& needle) {
-    if (needle.empty()) return true;
-    if (needle.size() > haystack.size()) return false;
-
-    for (size_t i = 0; i <= haystack.size() - needle.size(); ++i) {
-        bool match = true;
-        for (size_t j = 0; j < needle.size(); ++j) {
-            if (haystack[i + j] != needle[j]) {
-                match = false;
-                break;
-            }
-        }
-        if (match) return true;
-    }
-    return false;
-}
-
 void MainViewController::onShowAllByArtistButtonClicked() {
     isShowingAllTracksByArtist_ = !isShowingAllTracksByArtist_;
 
@@ -2728,51 +1460,11 @@ void MainViewController::onShowAllByArtistButtonClicked() {
         const UnityEngine::Color color(0.0f, 0.8118f, 1.0f, 1.0f);
         iconImageView->set_color(color);
         underlineImageView->set_color(color);
-
-        currentSongFilter_ = [](const SongDetailsCache::Song* const song, const airbuds::Track& track) {
-            // Remove songs that don't have at least one word from the Airbuds track in the name
-            bool didContainArtist = false;
-            for (const airbuds::Artist& artist : track.artists) {
-                const std::vector<std::string> artistTokens = AirbudsSearch::Filter::getWords(artist.name);
-                if (containsContiguous(AirbudsSearch::Filter::getWords(song->songAuthorName()), artistTokens)) {
-                    didContainArtist = true;
-                    break;
-                }
-                if (containsContiguous(AirbudsSearch::Filter::getWords(song->levelAuthorName()), artistTokens)) {
-                    didContainArtist = true;
-                    break;
-                }
-
-                // todo: handle case where song name contains artist but not correct
-                // todo: ex. artist = Luma; song name = "Luma Pools"
-                //if (containsContiguous(AirbudsSearch::Filter::getWords(song->songName()), artistTokens)) {
-                //    didContainArtist = true;
-                //    break;
-                //}
-            }
-            return didContainArtist;
-        };
-        currentSongScore_ = [](const airbuds::Track& track, const SongDetailsCache::Song& song) {
-            int score = 0;
-
-            // Increase score based on upvotes
-            score += song.upvotes;
-
-            // Decrease score based on downvotes
-            score -= song.downvotes;
-
-            score += song.upvotes + song.downvotes;
-
-            return score;
-        };
     } else {
         // Update the artist search button
         hoverHintComponent->set_text("Show all songs by this artist");
         iconImageView->set_color(UnityEngine::Color::get_white());
         underlineImageView->set_color(UnityEngine::Color::get_white());
-
-        currentSongFilter_ = AirbudsSearch::Filter::DEFAULT_SONG_FILTER_FUNCTION;
-        currentSongScore_ = AirbudsSearch::Filter::DEFAULT_SONG_SCORE_FUNCTION;
     }
 
     // Hide and show the hover hint to update the text
@@ -19,6 +19,7 @@
 #include "assets.hpp"
 #include "BeatSaverUtils.hpp"
 #include "Log.hpp"
+#include "SingleFlight.hpp"
 #include "SpriteCache.hpp"
 #include "UI/FlowCoordinators/AirbudsSearchFlowCoordinator.hpp"
 #include "Utils.hpp"
@@ -91,8 +92,11 @@ void AirbudsSearch::Utils::getImageAsSprite(std::string url, std::function<void(
     }
 
     std::thread([url, onLoadComplete] {
-        // Send request
-        const auto response = WebUtils::Get<WebUtils::DataResponse>(WebUtils::URLOptions(url));
+        // Send request. Table cells often load the same cover at the same time, so they share one download.
+        static AirbudsSearch::SingleFlight<WebUtils::DataResponse> inFlightImageRequests;
+        const auto response = inFlightImageRequests.run(url, [&url]() {
+            return WebUtils::Get<WebUtils::DataResponse>(WebUtils::URLOptions(url));
+        });
         const std::optional<std::vector<uint8_t>> data = response.responseData;
         if (!response.IsSuccessful()) {
             AirbudsSearch::Log.error("Request failed: code = {} url = {}", response.httpCode, url);
@@ -10,6 +10,7 @@
 
 #include "BeatSaverUtils.hpp"
 #include "Configuration.hpp"
+#include "LocalSongIndex.hpp"
 #include "Log.hpp"
 #include "Airbuds/AirbudsClient.hpp"
 #include "UI/FlowCoordinators/AirbudsSearchFlowCoordinator.hpp"
@@ -66,6 +67,35 @@ MOD_EXTERN_FUNC void setup(CModInfo* info) noexcept {
     }
 
     auto& config = getConfig().config;
+    if (!config.HasMember("search")) {
+        rapidjson::Value searchJson;
+        searchJson.SetObject();
+        config.AddMember("search", searchJson, config.GetAllocator());
+    } else if (!config["search"].IsObject()) {
+        config["search"].SetObject();
+    }
+    if (!config["search"].HasMember("maxConcurrentRequests")) {
+        config["search"].AddMember("maxConcurrentRequests", 4, config.GetAllocator());
+    }
+    if (!config["search"].HasMember("progressiveResults")) {
+        config["search"].AddMember("progressiveResults", true, config.GetAllocator());
+    }
+    if (!config["search"].HasMember("onlineSearch")) {
+        config["search"].AddMember("onlineSearch", true, config.GetAllocator());
+    }
+    if (!config["search"].HasMember("cacheTtlHours")) {
+        config["search"].AddMember("cacheTtlHours", 24, config.GetAllocator());
+    }
+    if (!config["search"].HasMember("cacheMaxSizeMB")) {
+        config["search"].AddMember("cacheMaxSizeMB", 32, config.GetAllocator());
+    }
+    if (!config["search"].HasMember("prefetchCount")) {
+        config["search"].AddMember("prefetchCount", 3, config.GetAllocator());
+    }
+    if (!config["search"].HasMember("matchIndexTtlHours")) {
+        config["search"].AddMember("matchIndexTtlHours", 168, config.GetAllocator());
+    }
+
     if (!config.HasMember("airbuds")) {
         rapidjson::Value airbudsJson;
         airbudsJson.SetObject();
@@ -77,6 +107,15 @@ MOD_EXTERN_FUNC void setup(CModInfo* info) noexcept {
     if (!config["airbuds"].HasMember("refreshToken")) {
         config["airbuds"].AddMember("refreshToken", "", config.GetAllocator());
     }
+    if (!config["airbuds"].HasMember("friendHistorySync")) {
+        config["airbuds"].AddMember("friendHistorySync", false, config.GetAllocator());
+    }
+    if (!config["airbuds"].HasMember("friendHistoryMaxConnections")) {
+        config["airbuds"].AddMember("friendHistoryMaxConnections", 2, config.GetAllocator());
+    }
+    if (!config["airbuds"].HasMember("friendHistoryRequestsPerMinute")) {
+        config["airbuds"].AddMember("friendHistoryRequestsPerMinute", 30, config.GetAllocator());
+    }
 
     if (config.HasMember("thirdParty") && config["thirdParty"].IsObject()) {
         const auto& thirdParty = config["thirdParty"];
@@ -171,4 +210,7 @@ MOD_EXTERN_FUNC void late_load() noexcept {
 
     // Initialize BeatSaver utils
     AirbudsSearch::BeatSaverUtils::getInstance().init();
+
+    // Build the local song index in the background
+    AirbudsSearch::LocalSongIndex::getInstance().buildAsync();
 }